@@ -0,0 +1,207 @@
+#ifndef BTWM_BINDINGS_HPP
+#define BTWM_BINDINGS_HPP
+
+#include <x11.hpp>
+#include <utils.hpp>
+
+#include <X11/keysym.h>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace btwm {
+	namespace bindings {
+		// modifiers a binding has to match exactly; caps and num lock are ignored
+		constexpr auto significant_mods = x11::mod_mask::shift | x11::mod_mask::control | x11::mod_mask::mod1 | x11::mod_mask::mod4;
+
+		[[nodiscard]] inline auto match_for(x11::key_code code, unsigned int modifiers) -> x11::key_match {
+			const auto mods = static_cast<x11::mod_mask>(modifiers);
+			return { code, mods, static_cast<x11::mod_mask>(static_cast<x11::mod_mask_base>(significant_mods) & ~modifiers) };
+		}
+
+		// keys that only change the state of the others
+		constexpr std::array<x11::key_sym_base, 19> modifier_keysyms = {
+			XK_Shift_L, XK_Shift_R, XK_Control_L, XK_Control_R, XK_Caps_Lock, XK_Shift_Lock,
+			XK_Meta_L, XK_Meta_R, XK_Alt_L, XK_Alt_R, XK_Super_L, XK_Super_R, XK_Hyper_L, XK_Hyper_R,
+			XK_ISO_Level3_Shift, XK_Mode_switch, XK_Num_Lock, XK_ISO_Level5_Shift, XK_ISO_Next_Group
+		};
+
+		/*
+		 * All modes compiled into one state machine. Every mode has a table indexed by key
+		 * code; a key press is one array access plus a scan over the few bindings that share
+		 * the key. The default mode works through passive grabs on the root window, the other
+		 * modes grab the whole keyboard once when they are entered.
+		 */
+		class key_machine {
+		public:
+			static constexpr std::size_t default_mode = 0;
+			static constexpr std::size_t no_mode = std::numeric_limits<std::size_t>::max();
+
+			struct transition {
+				x11::key_match match;
+				key_command command;
+				// mode entered by a mode command
+				std::size_t target;
+			};
+
+			template <typename Display>
+			key_machine(Display& display, array_view<const key_mode> modes, array_view<const key_binding> bindings):
+				m_bindings(bindings.begin(), bindings.end())
+			{
+				for(auto & m : modes) {
+					m_modes.push_back({ m.name, m.oneshot, {} });
+				}
+				if(m_modes.empty()) {
+					throw std::runtime_error("key bindings need at least one mode");
+				}
+				compile(display);
+			}
+
+			// (re)builds the tables with the current keyboard mapping, the old ones stay in use if this throws
+			template <typename Display>
+			void compile(Display& display) {
+				auto modes = m_modes;
+				std::bitset<std::numeric_limits<x11::key_code_base>::max() + 1> modifiers;
+				for(auto sym : modifier_keysyms) {
+					const auto code = display.keysym_to_keycode(static_cast<x11::key_sym>(sym));
+					if(code != x11::key_code{}) {
+						modifiers.set(static_cast<x11::key_code_base>(code));
+					}
+				}
+				for(auto & m : modes) {
+					for(auto & key : m.keys) {
+						key.clear();
+					}
+				}
+				for(auto & b : m_bindings) {
+					const auto mode = find_mode(b.mode);
+					if(mode == no_mode) {
+						throw std::runtime_error(std::string("key binding for unknown mode '") + b.mode + "'");
+					}
+					auto target = no_mode;
+					if(b.command.action == key_action::mode) {
+						target = find_mode(b.command.arg);
+						if(target == no_mode) {
+							throw std::runtime_error(std::string("key binding enters unknown mode '") + b.command.arg + "'");
+						}
+					}
+					const auto code = display.keysym_to_keycode(static_cast<x11::key_sym>(b.keysym));
+					if(code == x11::key_code{}) {
+						continue;
+					}
+					modes[mode].keys[static_cast<x11::key_code_base>(code)].push_back({ match_for(code, b.modifiers), b.command, target });
+				}
+				m_modes = std::move(modes);
+				m_modifier_keys = modifiers;
+			}
+
+			/*
+			 * After a keyboard mapping change: resolves every key sym again and only ungrabs
+			 * and grabs the default mode keys whose code actually changed.
+			 */
+			template <typename Display>
+			void remap(Display& display, const x11::window& root) {
+				const auto old_grabs = grabs();
+				compile(display);
+				const auto new_grabs = grabs();
+				auto contains = [](const std::vector<x11::key_match>& v, const x11::key_match& m) {
+					return std::any_of(v.begin(), v.end(), [&](const x11::key_match& o) {
+							return o.key_code == m.key_code && o.include_mask == m.include_mask && o.exclude_mask == m.exclude_mask;
+						});
+				};
+				for(auto & m : old_grabs) {
+					if(!contains(new_grabs, m)) {
+						display.ungrab_key(m, root);
+					}
+				}
+				for(auto & m : new_grabs) {
+					if(!contains(old_grabs, m)) {
+						display.grab_key(m, root, false, x11::grab_mode::async, x11::grab_mode::async);
+					}
+				}
+			}
+
+			// passive grabs for every binding of the default mode
+			template <typename Display>
+			void grab(Display& display, const x11::window& root) const {
+				for(auto & m : grabs()) {
+					display.grab_key(m, root, false, x11::grab_mode::async, x11::grab_mode::async);
+				}
+			}
+
+			/*
+			 * In a oneshot mode the modifiers that were held when it was entered may still be
+			 * down: Super+w then Super+q finds the binding for a plain q if there is no other.
+			 */
+			[[nodiscard]] auto lookup(x11::key_code_base code, unsigned int state) const -> const transition* {
+				if(auto t = find(code, state)) {
+					return t;
+				}
+				if(m_held != 0 && (state & m_held) != 0) {
+					return find(code, state & ~m_held);
+				}
+				return nullptr;
+			}
+
+			[[nodiscard]] auto is_modifier(x11::key_code_base code) const -> bool { return m_modifier_keys.test(code); }
+
+			[[nodiscard]] auto mode() const -> std::size_t { return m_current; }
+			[[nodiscard]] auto mode_name() const -> const char* { return m_modes[m_current].name; }
+			[[nodiscard]] auto oneshot() const -> bool { return m_modes[m_current].oneshot; }
+			// `held` is the state of the key press that entered the mode
+			void set_mode(std::size_t mode, unsigned int held = 0) {
+				m_current = mode;
+				m_held = m_modes[mode].oneshot ? held & static_cast<x11::mod_mask_base>(significant_mods) : 0;
+			}
+
+		private:
+			struct mode_table {
+				const char* name;
+				bool oneshot;
+				std::array<std::vector<transition>, std::numeric_limits<x11::key_code_base>::max() + 1> keys;
+			};
+
+			[[nodiscard]] auto find(x11::key_code_base code, unsigned int state) const -> const transition* {
+				for(auto & t : m_modes[m_current].keys[code]) {
+					if(t.match.matches_mod_mask(state)) {
+						return &t;
+					}
+				}
+				return nullptr;
+			}
+
+			[[nodiscard]] auto grabs() const -> std::vector<x11::key_match> {
+				std::vector<x11::key_match> result;
+				for(auto & key : m_modes[default_mode].keys) {
+					for(auto & t : key) {
+						result.push_back(t.match);
+					}
+				}
+				return result;
+			}
+
+			[[nodiscard]] auto find_mode(const char* name) const -> std::size_t {
+				for(std::size_t i = 0; i < m_modes.size(); ++i) {
+					if(name && std::strcmp(m_modes[i].name, name) == 0) {
+						return i;
+					}
+				}
+				return no_mode;
+			}
+
+			std::vector<key_binding> m_bindings;
+			std::vector<mode_table> m_modes;
+			std::size_t m_current = default_mode;
+			unsigned int m_held = 0;
+			std::bitset<std::numeric_limits<x11::key_code_base>::max() + 1> m_modifier_keys;
+		};
+	}
+}
+
+#endif
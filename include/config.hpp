@@ -1,10 +1,114 @@
 #ifndef BTWM_CONFIG_HPP
 #define BTWM_CONFIG_HPP
 
+#include <utils.hpp>
+
+extern "C" {
+#include <X11/X.h>
+#include <X11/keysym.h>
+}
+
+#include <array>
+#include <chrono>
+
 namespace btwm {
 	namespace config {
 		constexpr auto gaps = 5;
 		constexpr auto outer_gaps = 5;
+
+		// drawn inside the tile, the window itself gets 2 * border_width less
+		constexpr auto border_width = 2;
+		constexpr auto focused_border_color = "#5294e2";
+		constexpr auto unfocused_border_color = "#383c4a";
+
+		// longest wait for a client to paint after a _NET_WM_SYNC_REQUEST
+		constexpr auto sync_timeout = std::chrono::milliseconds(100);
+
+		// a closed window that is still mapped after close_timeout is pinged, then killed if it does not answer
+		constexpr auto close_timeout = std::chrono::milliseconds(2000);
+		constexpr auto ping_timeout = std::chrono::milliseconds(1000);
+
+		// focus the window under the pointer whenever the pointer enters it
+		constexpr bool focus_follows_mouse = false;
+
+		// a held binding fires at most once per interval
+		constexpr auto key_repeat_interval = std::chrono::milliseconds(80);
+
+		// a tile starts with weight 100, each resize step moves it by this much
+		constexpr auto resize_step = 10;
+		// pixels a floating window moves or grows per step
+		constexpr auto floating_step = 20;
+
+		// the first mode is active whenever no other is, only its bindings are grabbed
+		constexpr std::array<key_mode, 4> modes = {
+			key_mode{ "default", false },
+			key_mode{ "resize", false },
+			key_mode{ "move", false },
+			key_mode{ "window", true },
+		};
+
+		constexpr auto super = Mod4Mask;
+		constexpr auto super_shift = Mod4Mask | ShiftMask;
+		constexpr std::array<key_binding, 33> bindings = {
+			key_binding{ "default", super, XK_h, commands::focus(direction::left) },
+			key_binding{ "default", super, XK_j, commands::focus(direction::down) },
+			key_binding{ "default", super, XK_k, commands::focus(direction::up) },
+			key_binding{ "default", super, XK_l, commands::focus(direction::right) },
+			key_binding{ "default", super_shift, XK_h, commands::move(direction::left) },
+			key_binding{ "default", super_shift, XK_j, commands::move(direction::down) },
+			key_binding{ "default", super_shift, XK_k, commands::move(direction::up) },
+			key_binding{ "default", super_shift, XK_l, commands::move(direction::right) },
+			key_binding{ "default", super_shift, XK_q, commands::kill() },
+			key_binding{ "default", super_shift, XK_e, commands::quit() },
+			key_binding{ "default", super, XK_e, commands::split(split_type::toggle) },
+			key_binding{ "default", super, XK_Return, commands::spawn("st") },
+			key_binding{ "default", super, XK_space, commands::spawn("dmenu_run") },
+			key_binding{ "default", super, XK_r, commands::mode("resize") },
+			key_binding{ "default", super, XK_m, commands::mode("move") },
+			key_binding{ "default", super, XK_w, commands::mode("window") },
+
+			key_binding{ "resize", 0, XK_h, commands::resize(direction::left) },
+			key_binding{ "resize", 0, XK_j, commands::resize(direction::down) },
+			key_binding{ "resize", 0, XK_k, commands::resize(direction::up) },
+			key_binding{ "resize", 0, XK_l, commands::resize(direction::right) },
+			key_binding{ "resize", 0, XK_Escape, commands::mode("default") },
+			key_binding{ "resize", 0, XK_Return, commands::mode("default") },
+
+			key_binding{ "move", 0, XK_h, commands::move(direction::left) },
+			key_binding{ "move", 0, XK_j, commands::move(direction::down) },
+			key_binding{ "move", 0, XK_k, commands::move(direction::up) },
+			key_binding{ "move", 0, XK_l, commands::move(direction::right) },
+			key_binding{ "move", 0, XK_Escape, commands::mode("default") },
+			key_binding{ "move", 0, XK_Return, commands::mode("default") },
+
+			key_binding{ "window", 0, XK_q, commands::kill() },
+			key_binding{ "window", 0, XK_v, commands::split(split_type::vertical) },
+			key_binding{ "window", 0, XK_s, commands::split(split_type::horizontal) },
+			key_binding{ "window", 0, XK_e, commands::split(split_type::toggle) },
+			key_binding{ "window", 0, XK_Escape, commands::mode("default") },
+		};
+
+		/*
+		 * Placement of new windows, the first matching rule wins.
+		 * Rules on the title or role cost two extra round trips for every new window.
+		 *   class, instance, title, role, floating, split, target
+		 */
+		constexpr std::array<rule, 3> rules = {
+			rule{ "Pinentry", nullptr, nullptr, nullptr, rule_floating::floating },
+			rule{ "Gcr-prompter", nullptr, nullptr, nullptr, rule_floating::floating },
+			rule{ "Zathura", nullptr, nullptr, nullptr, rule_floating::tiled, rule_split::none, "Emacs" },
+		};
+
+		// lowest level that is logged per subsystem; everything below is compiled out
+		constexpr auto log_threshold(log_subsystem s) -> log_level {
+			switch (s) {
+				case log_subsystem::events: return log_level::info;
+				case log_subsystem::keys:   return log_level::info;
+				case log_subsystem::layout: return log_level::info;
+				case log_subsystem::x11:    return log_level::warning;
+			}
+			return log_level::info;
+		}
 	}
 }
 
@@ -0,0 +1,332 @@
+#ifndef BTWM_EVENT_RECORD_HPP
+#define BTWM_EVENT_RECORD_HPP
+
+#include <x11.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace btwm {
+	namespace recording {
+		// everything a replay needs to know about the recorded X server
+		struct session_info {
+			x11::window root;
+			int width;
+			int height;
+			std::vector<std::pair<x11::key_code, x11::key_sym_base>> keymap;
+			// the server's ids for x11::atoms::names, recorded events and replies use them
+			std::vector<std::pair<std::string, x11::atom>> atoms;
+		};
+
+		[[nodiscard]] inline auto capture_session(x11::display& display) -> session_info {
+			auto screen = display.default_screen();
+			session_info info{
+				display.default_root_window(),
+				display.display_width(screen),
+				display.display_height(screen),
+				display.keyboard_mapping(),
+				{}
+			};
+			const auto ids = display.intern_atoms(x11::atoms::names);
+			for(std::size_t i = 0; i < ids.size(); ++i) {
+				info.atoms.emplace_back(x11::atoms::names[i], ids[i]);
+			}
+			return info;
+		}
+
+		// only the part of the union that belongs to the event type is stored
+		[[nodiscard]] constexpr auto payload_size(int type) -> std::size_t {
+			switch(type) {
+				case KeyPress: [[fallthrough]];
+				case KeyRelease:       return sizeof(x11::events::key_pressed);
+				case ButtonPress: [[fallthrough]];
+				case ButtonRelease:    return sizeof(::XButtonEvent);
+				case MotionNotify:     return sizeof(::XMotionEvent);
+				case EnterNotify: [[fallthrough]];
+				case LeaveNotify:      return sizeof(::XCrossingEvent);
+				case FocusIn: [[fallthrough]];
+				case FocusOut:         return sizeof(::XFocusChangeEvent);
+				case CreateNotify:     return sizeof(x11::events::create_window);
+				case DestroyNotify:    return sizeof(::XDestroyWindowEvent);
+				case UnmapNotify:      return sizeof(x11::events::unmap);
+				case MapNotify:        return sizeof(::XMapEvent);
+				case MapRequest:       return sizeof(x11::events::map_request);
+				case ReparentNotify:   return sizeof(::XReparentEvent);
+				case ConfigureNotify:  return sizeof(::XConfigureEvent);
+				case ConfigureRequest: return sizeof(x11::events::configure_request);
+				case PropertyNotify:   return sizeof(::XPropertyEvent);
+				case ClientMessage:    return sizeof(x11::events::client_message);
+				case MappingNotify:    return sizeof(::XMappingEvent);
+				default:               return sizeof(x11::events::event);
+			}
+		}
+
+		constexpr std::array<char, 8> file_magic = { 'b', 't', 'w', 'm', 'r', 'e', 'c', '4' };
+
+		// set in the type of events that were dequeued and folded into the event handled before them
+		constexpr std::uint16_t coalesced_flag = 0x8000;
+		// type of the records that hold a query answer, see x11::reply
+		constexpr std::uint16_t reply_type = 0x7fff;
+		// an IPC batch, the payload is the command line the client sent
+		constexpr std::uint16_t batch_type = 0x7ffe;
+		// timers that were due, without payload
+		constexpr std::uint16_t timers_type = 0x7ffd;
+
+		// what run() handled: an X event, an IPC batch or the timers that were due
+		enum class entry_kind {
+			event,
+			batch,
+			timers
+		};
+
+		struct entry {
+			entry_kind kind;
+			x11::events::event event;
+			// the command line of a batch
+			std::string line;
+			std::chrono::nanoseconds time;
+		};
+
+		/*
+		 * file layout (host byte order):
+		 *   magic, u64 root, i32 width, i32 height, u32 n, n * (u8 key code, u32 key sym),
+		 *   u32 n, n * (u64 atom, u16 length, name)
+		 *   then until eof: u64 ns since start, u16 event type (| coalesced_flag), u16 payload size, payload
+		 * A reply_type payload is u8 query, u64 window, u64 property, u32 n, n * i64, u32 length, text,
+		 * a batch_type payload the command line, a timers_type record has none.
+		 * Coalesced events and replies follow the entry whose handler dequeued or asked for them.
+		 */
+		class event_writer {
+			std::ofstream m_out;
+			std::chrono::steady_clock::time_point m_start;
+			std::string m_buffer;
+
+			template <typename T>
+			void put(const T& value) {
+				m_out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+
+			template <typename T>
+			void append(const T& value) {
+				m_buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+
+			void put_header(std::uint16_t type, std::size_t size, std::chrono::steady_clock::time_point at = std::chrono::steady_clock::now()) {
+				const auto t = at - m_start;
+				put(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t).count()));
+				put(type);
+				put(static_cast<std::uint16_t>(size));
+			}
+
+		public:
+			event_writer(const std::string& path, const session_info& info):
+				m_out(path, std::ios::binary | std::ios::trunc),
+				m_start(std::chrono::steady_clock::now())
+			{
+				if(!m_out) {
+					throw std::runtime_error("could not open event record file " + path);
+				}
+				m_out.write(file_magic.data(), file_magic.size());
+				put(static_cast<std::uint64_t>(info.root));
+				put(static_cast<std::int32_t>(info.width));
+				put(static_cast<std::int32_t>(info.height));
+				put(static_cast<std::uint32_t>(info.keymap.size()));
+				for(auto & [code, sym] : info.keymap) {
+					put(static_cast<std::uint8_t>(code));
+					put(static_cast<std::uint32_t>(sym));
+				}
+				put(static_cast<std::uint32_t>(info.atoms.size()));
+				for(auto & [name, atom] : info.atoms) {
+					put(static_cast<std::uint64_t>(atom));
+					put(static_cast<std::uint16_t>(name.size()));
+					m_out.write(name.data(), static_cast<std::streamsize>(name.size()));
+				}
+			}
+
+			void write(const x11::events::event& e, bool coalesced = false) {
+				const auto size = payload_size(e.type);
+				put_header(static_cast<std::uint16_t>(e.type | (coalesced ? coalesced_flag : 0)), size);
+				m_out.write(reinterpret_cast<const char*>(&e), static_cast<std::streamsize>(size));
+			}
+
+			void write(const x11::reply& r) {
+				// a property list never gets near the 64k a record can hold, cut it off if it does
+				constexpr std::size_t max_values = 4096;
+				const auto values = std::min(r.values.size(), max_values);
+				const auto text = std::min<std::size_t>(r.text.size(), 4096);
+				m_buffer.clear();
+				append(static_cast<std::uint8_t>(r.kind));
+				append(static_cast<std::uint64_t>(r.window));
+				append(static_cast<std::uint64_t>(r.property));
+				append(static_cast<std::uint32_t>(values));
+				for(std::size_t i = 0; i < values; ++i) {
+					append(static_cast<std::int64_t>(r.values[i]));
+				}
+				append(static_cast<std::uint32_t>(text));
+				m_buffer.append(r.text, 0, text);
+				put_header(reply_type, m_buffer.size());
+				m_out.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+			}
+
+			void write_batch(const std::string& line) {
+				const auto size = std::min<std::size_t>(line.size(), 0xffff);
+				put_header(batch_type, size);
+				m_out.write(line.data(), static_cast<std::streamsize>(size));
+			}
+
+			// `now` is the time the timers were checked against, a replay checks against the same
+			void write_timers(std::chrono::steady_clock::time_point now) {
+				put_header(timers_type, 0, now);
+			}
+
+			void flush() { m_out.flush(); }
+		};
+
+		class event_reader {
+			struct record {
+				entry value;
+				bool coalesced;
+				std::optional<x11::reply> reply;
+			};
+
+			std::ifstream m_in;
+			session_info m_info;
+			std::optional<record> m_ahead;
+			std::vector<x11::events::event> m_coalesced;
+			std::vector<x11::reply> m_replies;
+
+			template <typename T>
+			[[nodiscard]] auto get() -> T {
+				T value{};
+				m_in.read(reinterpret_cast<char*>(&value), sizeof(value));
+				return value;
+			}
+
+			[[nodiscard]] auto read_reply() -> x11::reply {
+				x11::reply r{};
+				r.kind = static_cast<x11::query>(get<std::uint8_t>());
+				r.window = static_cast<x11::window>(get<std::uint64_t>());
+				r.property = static_cast<x11::atom>(get<std::uint64_t>());
+				auto values = get<std::uint32_t>();
+				for(std::uint32_t i = 0; i < values && m_in; ++i) {
+					r.values.push_back(static_cast<long>(get<std::int64_t>()));
+				}
+				auto text = get<std::uint32_t>();
+				if(m_in && text <= 0xffff) {
+					r.text.resize(text);
+					m_in.read(r.text.data(), static_cast<std::streamsize>(text));
+				}
+				return r;
+			}
+
+			[[nodiscard]] auto read_record() -> std::optional<record> {
+				auto ns = get<std::uint64_t>();
+				auto type = get<std::uint16_t>();
+				auto size = get<std::uint16_t>();
+				record r{};
+				r.value.time = std::chrono::nanoseconds(ns);
+				if(!m_in) {
+					return std::nullopt;
+				}
+				if(type == reply_type) {
+					r.reply = read_reply();
+					return m_in ? std::optional<record>(std::move(r)) : std::nullopt;
+				}
+				if(type == batch_type) {
+					r.value.kind = entry_kind::batch;
+					r.value.line.resize(size);
+					m_in.read(r.value.line.data(), size);
+					return m_in ? std::optional<record>(std::move(r)) : std::nullopt;
+				}
+				if(type == timers_type) {
+					r.value.kind = entry_kind::timers;
+					return r;
+				}
+				auto & event = r.value.event;
+				if(size > sizeof(event)) {
+					return std::nullopt;
+				}
+				r.value.kind = entry_kind::event;
+				m_in.read(reinterpret_cast<char*>(&event), size);
+				event.type = type & ~coalesced_flag;
+				event.xany.display = nullptr;
+				r.coalesced = (type & coalesced_flag) != 0;
+				if(!m_in) {
+					return std::nullopt;
+				}
+				return r;
+			}
+
+		public:
+			explicit event_reader(const std::string& path):
+				m_in(path, std::ios::binary)
+			{
+				std::array<char, file_magic.size()> magic{};
+				m_in.read(magic.data(), magic.size());
+				if(!m_in || magic != file_magic) {
+					throw std::runtime_error("not an event record file: " + path);
+				}
+				m_info.root = static_cast<x11::window>(get<std::uint64_t>());
+				m_info.width = get<std::int32_t>();
+				m_info.height = get<std::int32_t>();
+				auto n = get<std::uint32_t>();
+				m_info.keymap.reserve(n);
+				for(std::uint32_t i = 0; i < n; ++i) {
+					auto code = static_cast<x11::key_code>(get<std::uint8_t>());
+					auto sym = static_cast<x11::key_sym_base>(get<std::uint32_t>());
+					m_info.keymap.emplace_back(code, sym);
+				}
+				auto atoms = get<std::uint32_t>();
+				for(std::uint32_t i = 0; i < atoms && m_in; ++i) {
+					auto atom = static_cast<x11::atom>(get<std::uint64_t>());
+					std::string name(get<std::uint16_t>(), '\0');
+					m_in.read(name.data(), static_cast<std::streamsize>(name.size()));
+					m_info.atoms.emplace_back(std::move(name), atom);
+				}
+				if(!m_in) {
+					throw std::runtime_error("truncated event record header: " + path);
+				}
+				m_ahead = read_record();
+			}
+
+			[[nodiscard]] auto info() const -> const session_info& { return m_info; }
+
+			// the next thing run() handled, false at the end of the file
+			[[nodiscard]] auto next(entry& e) -> bool {
+				while(m_ahead && m_ahead->reply) {
+					m_ahead = read_record();
+				}
+				if(!m_ahead) {
+					return false;
+				}
+				e = std::move(m_ahead->value);
+				m_coalesced.clear();
+				m_replies.clear();
+				while((m_ahead = read_record()) && (m_ahead->coalesced || m_ahead->reply)) {
+					if(m_ahead->reply) {
+						m_replies.push_back(std::move(*m_ahead->reply));
+					}
+					else {
+						m_coalesced.push_back(m_ahead->value.event);
+					}
+				}
+				return true;
+			}
+
+			// events the handler of the last entry took off the queue, oldest first
+			[[nodiscard]] auto coalesced() const -> const std::vector<x11::events::event>& { return m_coalesced; }
+			// what the server answered while the last entry was handled, in order
+			[[nodiscard]] auto replies() const -> const std::vector<x11::reply>& { return m_replies; }
+		};
+	}
+}
+
+#endif
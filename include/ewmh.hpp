@@ -0,0 +1,184 @@
+#ifndef BTWM_EWMH_HPP
+#define BTWM_EWMH_HPP
+
+#include <x11.hpp>
+#include <utils.hpp>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace btwm {
+	namespace ewmh {
+		/*
+		 * Root window properties for bars, pagers and tools like xdotool.
+		 * Remembers what was written last and only talks to the server when that changes;
+		 * new clients are appended to _NET_CLIENT_LIST instead of rewriting it.
+		 */
+		class root_properties {
+		public:
+			template <typename Display>
+			root_properties(Display& display, const x11::window& root, const x11::atoms& atoms):
+				m_root(root),
+				m_atoms(atoms)
+			{
+				m_check_window = display.create_window(root, { -1, -1, 1, 1 });
+				const std::array<long, 1> check{ static_cast<long>(m_check_window) };
+				for(auto & w : { m_root, m_check_window }) {
+					display.change_property(w, atoms.net_supporting_wm_check, x11::atom_types::window,
+							x11::prop_mode::replace, { check.data(), check.size() });
+				}
+				display.change_property(m_check_window, atoms.net_wm_name, atoms.utf8_string,
+						x11::prop_mode::replace, std::string("btwm"));
+
+				// _NET_WM_STATE itself is left out, none of its client messages are handled
+				const std::array<long, 19> supported{
+					static_cast<long>(atoms.net_supported),
+					static_cast<long>(atoms.net_supporting_wm_check),
+					static_cast<long>(atoms.net_wm_name),
+					static_cast<long>(atoms.net_client_list),
+					static_cast<long>(atoms.net_active_window),
+					static_cast<long>(atoms.net_number_of_desktops),
+					static_cast<long>(atoms.net_current_desktop),
+					static_cast<long>(atoms.net_wm_desktop),
+					static_cast<long>(atoms.net_close_window),
+					static_cast<long>(atoms.net_wm_state_focused),
+					static_cast<long>(atoms.net_wm_sync_request),
+					static_cast<long>(atoms.net_wm_window_type),
+					static_cast<long>(atoms.net_wm_window_type_dock),
+					static_cast<long>(atoms.net_wm_strut),
+					static_cast<long>(atoms.net_wm_strut_partial),
+					static_cast<long>(atoms.net_wm_ping),
+					static_cast<long>(atoms.net_wm_window_type_dialog),
+					static_cast<long>(atoms.net_wm_window_type_utility),
+					static_cast<long>(atoms.net_wm_window_type_splash)
+				};
+				display.change_property(m_root, atoms.net_supported, x11::atom_types::atom,
+						x11::prop_mode::replace, { supported.data(), supported.size() });
+				const std::array<long, 1> one{ 1 };
+				const std::array<long, 1> zero{ 0 };
+				display.change_property(m_root, atoms.net_number_of_desktops, x11::atom_types::cardinal,
+						x11::prop_mode::replace, { one.data(), one.size() });
+				display.change_property(m_root, atoms.net_current_desktop, x11::atom_types::cardinal,
+						x11::prop_mode::replace, { zero.data(), zero.size() });
+				display.change_property(m_root, atoms.net_client_list, x11::atom_types::window,
+						x11::prop_mode::replace, { m_clients.data(), m_clients.size() });
+				display.change_property(m_root, atoms.net_active_window, x11::atom_types::window,
+						x11::prop_mode::replace, { zero.data(), zero.size() });
+			}
+
+			template <typename Display>
+			void add_client(Display& display, const x11::window& w) {
+				if(std::find(m_clients.begin(), m_clients.end(), static_cast<long>(w)) != m_clients.end()) {
+					return;
+				}
+				m_clients.push_back(static_cast<long>(w));
+				display.change_property(m_root, m_atoms.net_client_list, x11::atom_types::window,
+						x11::prop_mode::append, { &m_clients.back(), 1 });
+				const std::array<long, 1> desktop{ 0 };
+				display.change_property(w, m_atoms.net_wm_desktop, x11::atom_types::cardinal,
+						x11::prop_mode::replace, { desktop.data(), desktop.size() });
+			}
+
+			template <typename Display>
+			void remove_client(Display& display, const x11::window& w) {
+				auto it = std::find(m_clients.begin(), m_clients.end(), static_cast<long>(w));
+				if(it == m_clients.end()) {
+					return;
+				}
+				m_clients.erase(it);
+				// there is no way to cut an element out of a property
+				display.change_property(m_root, m_atoms.net_client_list, x11::atom_types::window,
+						x11::prop_mode::replace, { m_clients.data(), m_clients.size() });
+				m_states.erase(w);
+				if(w == m_active) {
+					// the window is withdrawn, its _NET_WM_STATE is not touched anymore
+					m_active = x11::window{};
+					write_active(display);
+				}
+			}
+
+			/*
+			 * Also moves _NET_WM_STATE_FOCUSED. Only that entry is added or removed, the rest of
+			 * the state stays as the client set it; it is read on the first focus of a window
+			 * and again after the client changed it.
+			 */
+			template <typename Display>
+			void set_active(Display& display, const x11::window& w) {
+				if(w == m_active) {
+					return;
+				}
+				const auto focused = static_cast<long>(m_atoms.net_wm_state_focused);
+				if(m_active != x11::window{}) {
+					auto & s = cached_state(display, m_active);
+					s.atoms.erase(std::remove(s.atoms.begin(), s.atoms.end(), focused), s.atoms.end());
+					++s.own_writes;
+					display.change_property(m_active, m_atoms.net_wm_state, x11::atom_types::atom,
+							x11::prop_mode::replace, { s.atoms.data(), s.atoms.size() });
+				}
+				if(w != x11::window{}) {
+					auto & s = cached_state(display, w);
+					if(std::find(s.atoms.begin(), s.atoms.end(), focused) == s.atoms.end()) {
+						s.atoms.push_back(focused);
+						++s.own_writes;
+						display.change_property(w, m_atoms.net_wm_state, x11::atom_types::atom,
+								x11::prop_mode::append, { &s.atoms.back(), 1 });
+					}
+				}
+				m_active = w;
+				write_active(display);
+			}
+
+			// a PropertyNotify of _NET_WM_STATE: the cache is dropped unless it was our own write
+			void on_state_changed(const x11::window& w) {
+				auto it = m_states.find(w);
+				if(it == m_states.end()) {
+					return;
+				}
+				if(it->second.own_writes > 0) {
+					--it->second.own_writes;
+					return;
+				}
+				m_states.erase(it);
+			}
+
+			[[nodiscard]] auto active() const -> x11::window { return m_active; }
+			[[nodiscard]] auto clients() const -> const std::vector<long>& { return m_clients; }
+
+		private:
+			template <typename Display>
+			void write_active(Display& display) {
+				const std::array<long, 1> active{ static_cast<long>(m_active) };
+				display.change_property(m_root, m_atoms.net_active_window, x11::atom_types::window,
+						x11::prop_mode::replace, { active.data(), active.size() });
+			}
+
+			struct state {
+				std::vector<long> atoms;
+				// writes whose PropertyNotify has not arrived yet
+				unsigned int own_writes = 0;
+			};
+
+			template <typename Display>
+			auto cached_state(Display& display, const x11::window& w) -> state& {
+				auto it = m_states.find(w);
+				if(it == m_states.end()) {
+					it = m_states.emplace(w, state{ display.get_property(w, m_atoms.net_wm_state, x11::atom_types::atom), 0 }).first;
+				}
+				return it->second;
+			}
+
+			const x11::window m_root;
+			const x11::atoms& m_atoms;
+			x11::window m_check_window{};
+			x11::window m_active{};
+			std::vector<long> m_clients;
+			// _NET_WM_STATE of the windows that had the focus at least once
+			std::unordered_map<x11::window, state> m_states;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef BTWM_FLOATING_HPP
+#define BTWM_FLOATING_HPP
+
+#include <x11.hpp>
+#include <utils.hpp>
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+namespace btwm {
+	[[nodiscard]] inline auto is_fixed_size(const x11::normal_hints& h) -> bool {
+		return (h.flags & PMinSize) && (h.flags & PMaxSize) &&
+			h.min_width > 0 && h.min_height > 0 &&
+			h.min_width == h.max_width && h.min_height == h.max_height;
+	}
+
+	/*
+	 * Windows that stay out of the tiling tree: dialogs, fixed size and rule selected windows.
+	 * The stacking order (bottom to top) is an intrusive list, raising or lowering a window
+	 * is O(1) and costs exactly one ConfigureWindow request. Nothing here touches tiled windows.
+	 */
+	class floating_layer {
+	public:
+		struct node {
+			x11::window win;
+			rect geometry;
+			intrusive_list_hook<node> stacking;
+		};
+
+		[[nodiscard]] auto contains(const x11::window& w) const -> bool { return m_nodes.count(w) != 0; }
+		[[nodiscard]] auto empty() const -> bool { return m_nodes.empty(); }
+
+		[[nodiscard]] auto find(const x11::window& w) -> node* {
+			auto it = m_nodes.find(w);
+			return it == m_nodes.end() ? nullptr : it->second.get();
+		}
+
+		[[nodiscard]] auto bottom() const -> node* { return m_stack.front(); }
+		[[nodiscard]] auto top() const -> node* { return m_stack.back(); }
+
+		// places `w` at `r` on top of the stack
+		template <typename Display>
+		void add(Display& display, const x11::window& w, const rect& r) {
+			auto & n = m_nodes[w];
+			if (n) {
+				m_stack.unlink(*n);
+			}
+			n = std::make_unique<node>(node{ w, r, {} });
+			m_stack.push_back(*n);
+
+			x11::window_changes changes{};
+			changes.x = r.x;
+			changes.y = r.y;
+			changes.width = r.w;
+			changes.height = r.h;
+			changes.stack_mode = Above;
+			display.configure_window(w, CWX | CWY | CWWidth | CWHeight | CWStackMode, changes);
+		}
+
+		// moves and resizes without touching the stacking order
+		template <typename Display>
+		void place(Display& display, const x11::window& w, const rect& r) {
+			auto n = find(w);
+			if (!n || n->geometry == r) {
+				return;
+			}
+			n->geometry = r;
+			display.window_to_rect(w, r);
+		}
+
+		void remove(const x11::window& w) {
+			auto it = m_nodes.find(w);
+			if (it == m_nodes.end()) {
+				return;
+			}
+			m_stack.unlink(*it->second);
+			m_nodes.erase(it);
+		}
+
+		template <typename Display>
+		void raise(Display& display, const x11::window& w) {
+			auto n = find(w);
+			if (!n || n == top()) {
+				return;
+			}
+			auto above = top();
+			m_stack.unlink(*n);
+			m_stack.push_back(*n);
+			restack(display, *n, *above, Above);
+		}
+
+		// lowest floating window, still above every tiled window
+		template <typename Display>
+		void lower(Display& display, const x11::window& w) {
+			auto n = find(w);
+			if (!n || n == bottom()) {
+				return;
+			}
+			auto below = bottom();
+			m_stack.unlink(*n);
+			m_stack.push_front(*n);
+			restack(display, *n, *below, Below);
+		}
+
+		// keeps a newly mapped tiled window underneath the floating layer
+		template <typename Display>
+		void stack_below(Display& display, const x11::window& w) {
+			if (auto b = bottom()) {
+				x11::window_changes changes{};
+				changes.sibling = static_cast<x11::window_base>(b->win);
+				changes.stack_mode = Below;
+				display.configure_window(w, CWSibling | CWStackMode, changes);
+			}
+		}
+
+	private:
+		template <typename Display>
+		static void restack(Display& display, const node& n, const node& sibling, int mode) {
+			x11::window_changes changes{};
+			changes.sibling = static_cast<x11::window_base>(sibling.win);
+			changes.stack_mode = mode;
+			display.configure_window(n.win, CWSibling | CWStackMode, changes);
+		}
+
+		std::unordered_map<x11::window, std::unique_ptr<node>> m_nodes;
+		intrusive_list<node, &node::stacking> m_stack;
+	};
+}
+
+#endif
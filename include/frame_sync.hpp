@@ -0,0 +1,154 @@
+#ifndef BTWM_FRAME_SYNC_HPP
+#define BTWM_FRAME_SYNC_HPP
+
+#include <x11.hpp>
+#include <utils.hpp>
+#include <config.hpp>
+#include <log.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+namespace btwm {
+	/*
+	 * _NET_WM_SYNC_REQUEST: every configure of a supporting client is preceded by a sync
+	 * request, the client sets its counter to the requested value after it painted the new
+	 * size. Until all counters of a relayout arrived (or config::sync_timeout passed) the
+	 * window manager holds the next relayout back, so resize traffic never outruns painting.
+	 */
+	class frame_sync {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		explicit frame_sync(int event_base): m_event_type(event_base + XSyncAlarmNotify) { }
+
+		[[nodiscard]] auto event_type() const -> int { return m_event_type; }
+
+		// requests count up from the client's current value, one it already passed would be met at once
+		template <typename Display>
+		void add(Display& display, const x11::window& w, const x11::sync_counter& counter) {
+			const auto value = display.query_counter(counter);
+			if (!value) {
+				return;
+			}
+			m_clients.insert_or_assign(w, client{ counter, std::nullopt, *value, false });
+		}
+
+		template <typename Display>
+		void remove(Display& display, const x11::window& w) {
+			auto it = m_clients.find(w);
+			if (it == m_clients.end()) {
+				return;
+			}
+			if (it->second.alarm) {
+				display.destroy_alarm(*it->second.alarm);
+			}
+			if (it->second.waiting) {
+				--m_outstanding;
+			}
+			m_clients.erase(it);
+		}
+
+		// has to be called right before `w` is configured
+		template <typename Display>
+		void request(Display& display, const x11::atoms& atoms, const x11::window& w) {
+			auto it = m_clients.find(w);
+			if (it == m_clients.end()) {
+				return;
+			}
+			auto & c = it->second;
+			++c.value;
+
+			x11::events::event event{};
+			auto& msg = event.xclient;
+			msg.type = ClientMessage;
+			msg.window = static_cast<x11::window_base>(w);
+			msg.message_type = static_cast<x11::atom_base>(atoms.wm_protocols);
+			msg.format = 32;
+			msg.data.l[0] = static_cast<long>(atoms.net_wm_sync_request);
+			msg.data.l[1] = CurrentTime;
+			msg.data.l[2] = static_cast<long>(c.value & 0xffffffff);
+			msg.data.l[3] = static_cast<long>(c.value >> 32);
+			display.send_event(w, false, x11::event_mask::none, event);
+
+			if (c.alarm) {
+				display.change_alarm(*c.alarm, c.value);
+			} else {
+				c.alarm = display.create_alarm(c.counter, c.value);
+			}
+			if (!c.waiting) {
+				c.waiting = true;
+				++m_outstanding;
+			}
+			m_deadline = display.now() + config::sync_timeout;
+		}
+
+		// true if this was the last counter the current relayout waited for
+		bool on_alarm(const x11::events::sync_alarm_notify& e) {
+			for (auto & [w, c] : m_clients) {
+				if (c.alarm && static_cast<x11::sync_alarm_base>(*c.alarm) == e.alarm && c.waiting) {
+					c.waiting = false;
+					return --m_outstanding == 0;
+				}
+			}
+			return false;
+		}
+
+		[[nodiscard]] auto busy() const -> bool { return m_outstanding > 0; }
+
+		[[nodiscard]] auto deadline() const -> std::optional<clock::time_point> {
+			if (!busy()) {
+				return std::nullopt;
+			}
+			return m_deadline;
+		}
+
+		// gives up on clients that did not paint in time, true if it did
+		bool expire(clock::time_point now) {
+			if (!busy() || now < m_deadline) {
+				return false;
+			}
+			for (auto & [w, c] : m_clients) {
+				if (c.waiting) {
+					logging::debug<log_subsystem::layout>("window {} missed its sync request", w);
+					c.waiting = false;
+				}
+			}
+			m_outstanding = 0;
+			return true;
+		}
+
+	private:
+		struct client {
+			x11::sync_counter counter;
+			std::optional<x11::sync_alarm> alarm;
+			std::int64_t value;
+			bool waiting;
+		};
+
+		int m_event_type;
+		std::unordered_map<x11::window, client> m_clients;
+		std::size_t m_outstanding = 0;
+		clock::time_point m_deadline;
+	};
+
+	// what the layouts configure windows through during a relayout
+	template <typename Display>
+	struct synced_display {
+		Display& display;
+		frame_sync* sync;
+		const x11::atoms& atoms;
+
+		void window_to_rect(const x11::window& w, const rect& r) {
+			if (sync) {
+				sync->request(display, atoms, w);
+			}
+			display.window_to_rect(w, r);
+		}
+	};
+}
+
+#endif
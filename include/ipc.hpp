@@ -0,0 +1,401 @@
+#ifndef BTWM_IPC_HPP
+#define BTWM_IPC_HPP
+
+#include <x11.hpp>
+#include <layouts.hpp>
+#include <log.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+/*
+ * Line based control socket. Every line is one batch of commands separated by ';',
+ * applied as a single transaction, e.g.
+ *     focus left; move right; split toggle
+ * and answered with "ok" or "error <reason>". "subscribe focus window layout" turns
+ * the connection into an event stream with lines like "event focus 0x1c00002".
+ */
+
+namespace btwm {
+	namespace ipc {
+		enum class command_type {
+			focus,
+			move,
+			split,
+			kill,
+			spawn,
+			subscribe,
+			trace
+		};
+
+		using split_type = btwm::split_type;
+
+		enum class event_kind: std::uint8_t {
+			focus = 1 << 0,
+			window = 1 << 1,
+			layout = 1 << 2
+		};
+
+		struct command {
+			command_type type;
+			direction dir = direction::next;
+			split_type split = split_type::toggle;
+			std::uint8_t events = 0;
+			std::vector<std::string> args;
+		};
+
+		[[nodiscard]] inline auto parse_direction(const std::string& word) -> direction {
+			if(word == "left")  { return direction::left; }
+			if(word == "right") { return direction::right; }
+			if(word == "up")    { return direction::up; }
+			if(word == "down")  { return direction::down; }
+			throw std::invalid_argument("unknown direction '" + word + "'");
+		}
+
+		[[nodiscard]] inline auto parse_command(const std::string& text) -> command {
+			std::istringstream in(text);
+			std::vector<std::string> words;
+			for(std::string w; in >> w;) {
+				words.push_back(std::move(w));
+			}
+			if(words.empty()) {
+				throw std::invalid_argument("empty command");
+			}
+			auto expect_args = [&](std::size_t n) {
+				if(words.size() != n + 1) {
+					throw std::invalid_argument("wrong number of arguments for '" + words[0] + "'");
+				}
+			};
+
+			command c{};
+			if(words[0] == "focus" || words[0] == "move") {
+				expect_args(1);
+				c.type = words[0] == "focus" ? command_type::focus : command_type::move;
+				c.dir = parse_direction(words[1]);
+			}
+			else if(words[0] == "split") {
+				expect_args(1);
+				c.type = command_type::split;
+				if(words[1] == "h")           { c.split = split_type::horizontal; }
+				else if(words[1] == "v")      { c.split = split_type::vertical; }
+				else if(words[1] == "toggle") { c.split = split_type::toggle; }
+				else { throw std::invalid_argument("unknown split '" + words[1] + "'"); }
+			}
+			else if(words[0] == "kill") {
+				expect_args(0);
+				c.type = command_type::kill;
+			}
+			else if(words[0] == "spawn") {
+				if(words.size() < 2) {
+					throw std::invalid_argument("spawn needs a program");
+				}
+				c.type = command_type::spawn;
+				c.args.assign(words.begin() + 1, words.end());
+			}
+			else if(words[0] == "trace") {
+				c.type = command_type::trace;
+				if(words.size() == 2 && words[1] == "start") { }
+				else if(words.size() == 3 && words[1] == "stop") { }
+				else { throw std::invalid_argument("usage: trace start | trace stop FILE"); }
+				c.args.assign(words.begin() + 1, words.end());
+			}
+			else if(words[0] == "subscribe") {
+				if(words.size() < 2) {
+					throw std::invalid_argument("subscribe needs at least one event");
+				}
+				c.type = command_type::subscribe;
+				for(auto it = words.begin() + 1; it != words.end(); ++it) {
+					if(*it == "focus")       { c.events |= static_cast<std::uint8_t>(event_kind::focus); }
+					else if(*it == "window") { c.events |= static_cast<std::uint8_t>(event_kind::window); }
+					else if(*it == "layout") { c.events |= static_cast<std::uint8_t>(event_kind::layout); }
+					else { throw std::invalid_argument("unknown event '" + *it + "'"); }
+				}
+			}
+			else {
+				throw std::invalid_argument("unknown command '" + words[0] + "'");
+			}
+			return c;
+		}
+
+		[[nodiscard]] inline auto parse_batch(const std::string& line) -> std::vector<command> {
+			std::vector<command> batch;
+			std::string::size_type begin = 0;
+			for(;;) {
+				auto end = line.find(';', begin);
+				auto part = line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+				if(part.find_first_not_of(" \t\r") != std::string::npos) {
+					batch.push_back(parse_command(part));
+				}
+				if(end == std::string::npos) {
+					return batch;
+				}
+				begin = end + 1;
+			}
+		}
+
+		[[nodiscard]] inline auto format_window(const x11::window& w) -> std::string {
+			char buffer[2 + 2 * sizeof(x11::window_base) + 1];
+			std::snprintf(buffer, sizeof(buffer), "0x%lx", static_cast<unsigned long>(w));
+			return buffer;
+		}
+
+		[[nodiscard]] inline auto default_socket_path() -> std::string {
+			const char* display = std::getenv("DISPLAY");
+			const std::string suffix = std::string("btwm.") + (display ? display : ":0") + ".sock";
+			if(const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR")) {
+				return std::string(runtime_dir) + "/" + suffix;
+			}
+			return "/tmp/" + std::to_string(getuid()) + "-" + suffix;
+		}
+
+		/*
+		 * All sockets are non-blocking. Output that a client does not read is buffered up
+		 * to max_pending_output, after that the client is dropped instead of stalling the WM.
+		 */
+		class server {
+		public:
+			static constexpr std::size_t max_pending_output = 1 << 16;
+			static constexpr std::size_t max_line_length = 1 << 12;
+
+			explicit server(std::string path): m_path(std::move(path)) {
+				sockaddr_un addr{};
+				addr.sun_family = AF_UNIX;
+				if(m_path.size() >= sizeof(addr.sun_path)) {
+					throw std::runtime_error("ipc socket path too long: " + m_path);
+				}
+				std::copy(m_path.begin(), m_path.end(), addr.sun_path);
+
+				m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+				if(m_fd < 0) {
+					throw std::runtime_error("could not create ipc socket");
+				}
+				unlink(m_path.c_str());
+				if(bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(m_fd, 8) < 0) {
+					close(m_fd);
+					throw std::runtime_error("could not listen on " + m_path);
+				}
+			}
+			~server() {
+				for(auto & c : m_clients) {
+					close(c.fd);
+				}
+				close(m_fd);
+				unlink(m_path.c_str());
+			}
+			server(const server&) = delete;
+			server& operator=(const server&) = delete;
+
+			[[nodiscard]] auto path() const -> const std::string& { return m_path; }
+
+			// appends the listening socket and all clients; dispatch() expects them at `first`
+			void poll_fds(std::vector<pollfd>& fds) const {
+				fds.push_back({ m_fd, POLLIN, 0 });
+				for(auto & c : m_clients) {
+					// after EOF the socket stays readable, only hang ups and output matter
+					short events = c.eof ? 0 : POLLIN;
+					if(!c.output.empty()) {
+						events |= POLLOUT;
+					}
+					fds.push_back({ c.fd, events, 0 });
+				}
+			}
+
+			/*
+			 * Has to be called after every poll(), closed clients are only removed here.
+			 * `handler(const std::vector<command>&, const std::string& line)` applies one batch
+			 * parsed from `line` and returns the reply, it may throw std::exception to report an
+			 * error to the client.
+			 */
+			template <typename Handler>
+			void dispatch(const std::vector<pollfd>& fds, std::size_t first, Handler&& handler) {
+				const auto known_clients = m_clients.size();
+				for(std::size_t i = 0; i < known_clients && first + 1 + i < fds.size(); ++i) {
+					auto & c = m_clients[i];
+					const auto revents = fds[first + 1 + i].revents;
+					if(revents & POLLIN) {
+						read_client(c, handler);
+					}
+					if(revents & POLLOUT) {
+						flush(c);
+						close_if_done(c);
+					}
+					if(revents & (POLLERR | POLLHUP | POLLNVAL)) {
+						c.closed = true;
+					}
+				}
+				if(fds.size() > first && (fds[first].revents & POLLIN)) {
+					accept_clients();
+				}
+				remove_closed();
+			}
+
+			[[nodiscard]] auto has_subscribers(event_kind kind) const -> bool {
+				return m_subscribed & static_cast<std::uint8_t>(kind);
+			}
+
+			void broadcast(event_kind kind, const std::string& line) {
+				for(auto & c : m_clients) {
+					if(c.events & static_cast<std::uint8_t>(kind)) {
+						send(c, line);
+					}
+				}
+			}
+
+		private:
+			struct client {
+				int fd;
+				std::string input;
+				std::string output;
+				std::uint8_t events = 0;
+				// the client shut down its write side, it is closed once its replies are out
+				bool eof = false;
+				bool closed = false;
+			};
+
+			std::string m_path;
+			int m_fd = -1;
+			std::vector<client> m_clients;
+			std::uint8_t m_subscribed = 0;
+
+			void accept_clients() {
+				for(;;) {
+					int fd = accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+					if(fd < 0) {
+						return;
+					}
+					m_clients.push_back({ fd, {}, {}, 0, false, false });
+				}
+			}
+
+			template <typename Handler>
+			void read_client(client& c, Handler& handler) {
+				char buffer[4096];
+				for(;;) {
+					auto n = read(c.fd, buffer, sizeof(buffer));
+					if(n == 0) {
+						c.eof = true;
+						break;
+					}
+					if(n < 0) {
+						if(errno == EINTR) {
+							continue;
+						}
+						if(errno != EAGAIN) {
+							c.closed = true;
+						}
+						break;
+					}
+					c.input.append(buffer, static_cast<std::size_t>(n));
+					handle_lines(c, handler);
+					if(c.closed) {
+						return;
+					}
+					// what is left is the start of a line
+					if(c.input.size() > max_line_length) {
+						logging::warning<log_subsystem::events>("ipc client {} sent an overlong line, dropped", c.fd);
+						c.closed = true;
+						return;
+					}
+				}
+				close_if_done(c);
+			}
+
+			template <typename Handler>
+			void handle_lines(client& c, Handler& handler) {
+				std::string::size_type pos;
+				while(!c.closed && (pos = c.input.find('\n')) != std::string::npos) {
+					auto line = c.input.substr(0, pos);
+					c.input.erase(0, pos + 1);
+					send(c, handle_line(c, line, handler));
+				}
+			}
+
+			// a subscriber may shut down its write side and keep listening
+			void close_if_done(client& c) {
+				if(c.eof && c.output.empty() && c.events == 0) {
+					c.closed = true;
+				}
+			}
+
+			template <typename Handler>
+			auto handle_line(client& c, const std::string& line, Handler& handler) -> std::string {
+				try {
+					auto batch = parse_batch(line);
+					auto reply = handler(batch, line);
+					// a batch that failed subscribes to nothing
+					for(auto & cmd : batch) {
+						if(cmd.type == command_type::subscribe) {
+							c.events |= cmd.events;
+							m_subscribed |= cmd.events;
+						}
+					}
+					return reply;
+				}
+				catch(const std::exception& e) {
+					return std::string("error ") + e.what();
+				}
+			}
+
+			void send(client& c, const std::string& line) {
+				if(c.closed) {
+					return;
+				}
+				if(c.output.size() + line.size() + 1 > max_pending_output) {
+					logging::warning<log_subsystem::events>("ipc client {} does not read its events, dropped", c.fd);
+					c.closed = true;
+					return;
+				}
+				c.output += line;
+				c.output += '\n';
+				flush(c);
+			}
+
+			void flush(client& c) {
+				while(!c.output.empty() && !c.closed) {
+					auto n = ::send(c.fd, c.output.data(), c.output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+					if(n < 0) {
+						if(errno != EAGAIN && errno != EINTR) {
+							c.closed = true;
+						}
+						return;
+					}
+					c.output.erase(0, static_cast<std::size_t>(n));
+				}
+			}
+
+			void remove_closed() {
+				auto it = std::remove_if(m_clients.begin(), m_clients.end(), [](const client& c) {
+						if(c.closed) {
+							close(c.fd);
+						}
+						return c.closed;
+					});
+				if(it == m_clients.end()) {
+					return;
+				}
+				m_clients.erase(it, m_clients.end());
+				m_subscribed = 0;
+				for(auto & c : m_clients) {
+					m_subscribed |= c.events;
+				}
+			}
+		};
+	}
+}
+
+#endif
@@ -5,10 +5,13 @@
 #include <utils.hpp>
 #include <config.hpp>
 
+#include <optional>
 #include <variant>
 #include <vector>
 #include <algorithm>
 #include <stack>
+#include <type_traits>
+#include <utility>
 
 namespace btwm {
 	inline namespace layouts {
@@ -17,45 +20,71 @@ namespace btwm {
 			could_not_focus,
 			focus_succeeded
 		};
-		enum class direction {
-			up,
-			down,
-			left,
-			right,
-			next,
-			prev,
-		};
+
+		// calls f with std::integral_constant<direction, dir>, for templates over a runtime direction
+		template <typename F>
+		void visit_direction(direction dir, F&& f) {
+			switch (dir) {
+				case direction::up:    f(std::integral_constant<direction, direction::up>{}); break;
+				case direction::down:  f(std::integral_constant<direction, direction::down>{}); break;
+				case direction::left:  f(std::integral_constant<direction, direction::left>{}); break;
+				case direction::right: f(std::integral_constant<direction, direction::right>{}); break;
+				case direction::next:  f(std::integral_constant<direction, direction::next>{}); break;
+				case direction::prev:  f(std::integral_constant<direction, direction::prev>{}); break;
+			}
+		}
 
 
 		struct layout_container;
 		struct layout_leave{
 			x11::window win;
+			// last geometry sent to the server, unchanged windows are not reconfigured
+			rect geometry{0, 0, 0, 0};
+			// share of the parent container, relative to the weights of its siblings
+			int weight = 100;
 			bool has_win(const x11::window& a_win) {
 				return win == a_win;
 			}
-			void resize(x11::display& display, const rect & r) {
-				display.window_to_rect(win, r);
+			template <typename Display>
+			void resize(Display& display, const rect & r) {
+				if (r == geometry) {
+					return;
+				}
+				geometry = r;
+				// one configure for position and size
+				display.window_to_rect(win, client_rect());
+			}
+			// the border is part of the tile, the client gets the rest; X rejects a size of 0
+			[[nodiscard]] auto client_rect() const -> rect {
+				return {
+					geometry.x,
+					geometry.y,
+					std::max(1, geometry.w - 2 * config::border_width),
+					std::max(1, geometry.h - 2 * config::border_width)
+				};
 			}
 			bool remove_window(const x11::window& a_win) {
 				return win == a_win;
 			}
 
-			void raise(x11::display& display) {
+			template <typename Display>
+			void raise(Display& display) {
 				display.raise_window(win);
 			}
 
-			void focus_any(x11::display& display) const {
+			template <typename Display>
+			void focus_any(Display& display) const {
 				display.set_input_focus(win, x11::revert_to::pointer_root, x11::time::current_time);
 			}
 
-			template<direction>
-			focus_data focus(x11::display&, const x11::window & w) const {
+			template<direction, typename Display>
+			focus_data focus(Display&, const x11::window & w) const {
 				return (w == win) ? focus_data::could_not_focus : focus_data::has_not_window;
 			}
 
 
-			template <direction dir>
-			focus_data move(x11::display&, const x11::window & w) const {
+			template <direction dir, typename Display>
+			focus_data move(Display&, const x11::window & w) const {
 				return (w == win) ? focus_data::could_not_focus : focus_data::has_not_window;
 			}
 		};
@@ -64,10 +93,11 @@ namespace btwm {
 
 
 		struct layout_vsplit {
-			void resize(x11::display& display, const rect & r, std::vector<layout_node>& sub_nodes);
+			template <typename Display>
+			void resize(Display& display, const rect & r, std::vector<layout_node>& sub_nodes);
 
-			template <direction dir>
-			focus_data focus(x11::display& display, const std::size_t win, std::vector<layout_node>& sub_nodes);
+			template <direction dir, typename Display>
+			focus_data focus(Display& display, const std::size_t win, std::vector<layout_node>& sub_nodes);
 
 			template <direction dir>
 			focus_data move(const std::size_t & w, std::vector<layout_node>& sub_nodes);
@@ -75,10 +105,11 @@ namespace btwm {
 			focus_data insert(layout_leave&& value, const std::size_t & w, std::vector<layout_node> & sub_nodes);
 		};
 		struct layout_hsplit {
-			void resize(x11::display& display, const rect & r, std::vector<layout_node>& sub_nodes);
+			template <typename Display>
+			void resize(Display& display, const rect & r, std::vector<layout_node>& sub_nodes);
 
-			template <direction dir>
-			focus_data focus(x11::display& display, const std::size_t win, std::vector<layout_node>& sub_nodes);
+			template <direction dir, typename Display>
+			focus_data focus(Display& display, const std::size_t win, std::vector<layout_node>& sub_nodes);
 
 			template <direction dir>
 			focus_data move(const std::size_t & w, std::vector<layout_node>& sub_nodes);
@@ -88,9 +119,13 @@ namespace btwm {
 
 		using layout_type = std::variant<layout_vsplit, layout_hsplit>;
 
+		[[nodiscard]] inline auto weight_of(layout_node& node) -> int&;
+		[[nodiscard]] inline auto total_weight(std::vector<layout_node>& sub_nodes) -> int;
+
 		struct layout_container{
 			std::vector<layout_node> sub_nodes;
 			layout_type type = layout_vsplit();
+			int weight = 100;
 
 			template <direction dir>
 			focus_data move(const std::size_t & index) {
@@ -165,17 +200,18 @@ namespace btwm {
 			}
 
 
-			void focus_any(x11::display& display) {
+			template <typename Display>
+			void focus_any(Display& display) {
 				std::visit([&](auto & node){node.focus_any(display);}, sub_nodes.front());
 			}
 
-			template <direction dir>
-			auto focus(x11::display& disp, const std::size_t & index) -> focus_data {
+			template <direction dir, typename Display>
+			auto focus(Display& disp, const std::size_t & index) -> focus_data {
 				return std::visit([&](auto & lt) -> focus_data { return lt.template focus<dir>(disp, index, sub_nodes);}, type);
 			}
 
-			template <direction dir>
-			auto focus_window(x11::display& disp, const x11::window & w) {
+			template <direction dir, typename Display>
+			auto focus_window(Display& disp, const x11::window & w) {
 				auto recurse = [&](auto & container, auto & self) -> focus_data {
 					std::size_t index = 0;
 					for(auto & elem: container.sub_nodes) {
@@ -207,7 +243,8 @@ namespace btwm {
 
 			void add(layout_node&& lt_node) { sub_nodes.push_back(std::move(lt_node)); }
 
-			void resize(x11::display& display, const rect& r) { std::visit([&](auto & layout){layout.resize(display, r, sub_nodes);}, type); }
+			template <typename Display>
+			void resize(Display& display, const rect& r) { std::visit([&](auto & layout){layout.resize(display, r, sub_nodes);}, type); }
 
 			bool remove_window(const x11::window& win) {
 				auto new_end = std::remove_if(std::begin(sub_nodes), std::end(sub_nodes), [&](layout_node & lt) -> bool{
@@ -217,6 +254,88 @@ namespace btwm {
 				return sub_nodes.empty();
 			}
 
+			/*
+			 * Grows (right, down) or shrinks (left, up) `win`, or the closest container around it
+			 * that is split along that axis, by `step` weight. False if there is nothing to resize.
+			 */
+			template <direction dir>
+			bool resize_window(const x11::window& win, int step) {
+				static_assert(dir != direction::next && dir != direction::prev, "resizes need a spatial direction");
+				constexpr bool horizontal = dir == direction::left || dir == direction::right;
+				constexpr bool grow = dir == direction::right || dir == direction::down;
+				enum class result { not_found, found, resized };
+				auto recurse = [&](layout_container& container, auto& self) -> result {
+					for (auto & node : container.sub_nodes) {
+						bool found = false;
+						if (auto leave = std::get_if<layout_leave>(&node)) {
+							found = leave->win == win;
+						}
+						else {
+							auto res = self(std::get<layout_container>(node), self);
+							if (res == result::resized) {
+								return res;
+							}
+							found = res == result::found;
+						}
+						if (!found) {
+							continue;
+						}
+						const bool along = horizontal == std::holds_alternative<layout_vsplit>(container.type);
+						if (!along || container.sub_nodes.size() < 2) {
+							return result::found;
+						}
+						auto & w = weight_of(node);
+						w = std::max(step, grow ? w + step : w - step);
+						return result::resized;
+					}
+					return result::not_found;
+				};
+				return recurse(*this, recurse) == result::resized;
+			}
+
+			// puts `win` right after `anchor`, both in a new container of `split` if that is given
+			bool insert_beside(const x11::window& anchor, const x11::window& win, const std::optional<layout_type>& split) {
+				for (auto it = sub_nodes.begin(); it != sub_nodes.end(); ++it) {
+					auto leave = std::get_if<layout_leave>(&*it);
+					if (!leave) {
+						if (std::get<layout_container>(*it).insert_beside(anchor, win, split)) {
+							return true;
+						}
+						continue;
+					}
+					if (leave->win != anchor) {
+						continue;
+					}
+					if (!split || split->index() == type.index()) {
+						sub_nodes.insert(it + 1, layout_leave{win});
+						return true;
+					}
+					layout_container sub;
+					sub.type = *split;
+					// the new container takes over the anchor's share
+					sub.weight = std::exchange(leave->weight, 100);
+					sub.add(std::move(*leave));
+					sub.add(layout_leave{win});
+					*it = std::move(sub);
+					return true;
+				}
+				return false;
+			}
+
+			layout_leave* find_leave(const x11::window& win) {
+				for( auto & node : sub_nodes ) {
+					if (auto leave = std::get_if<layout_leave>(&node)) {
+						if (leave->win == win) {
+							return leave;
+						}
+					}
+					else if (auto found = std::get<layout_container>(node).find_leave(win)) {
+						return found;
+					}
+				}
+				return nullptr;
+			}
+
 			bool has_win(const x11::window& win) {
 				for( auto & node : sub_nodes ) {
 					if(std::visit([&](auto& nnode) -> bool{return nnode.has_win(win);}, node)) {
@@ -227,30 +346,46 @@ namespace btwm {
 			}
 		};
 
-		void layout_vsplit::resize(x11::display& display, const rect & r, std::vector<layout_node>& sub_nodes) {
+		inline auto weight_of(layout_node& node) -> int& {
+			return std::visit([](auto & n) -> int& { return n.weight; }, node);
+		}
+
+		inline auto total_weight(std::vector<layout_node>& sub_nodes) -> int {
+			int total = 0;
+			for(auto & subnode: sub_nodes) {
+				total += weight_of(subnode);
+			}
+			return total;
+		}
+
+		template <typename Display>
+		void layout_vsplit::resize(Display& display, const rect & r, std::vector<layout_node>& sub_nodes) {
 			if(sub_nodes.empty()) { return; }
 			int spacing_w = static_cast<int>(sub_nodes.size() - 1) * config::gaps;
-			int width_per_win = (r.w - spacing_w) / static_cast<int>(sub_nodes.size());
+			int total = total_weight(sub_nodes);
 			auto x = r.x;
 			for(auto & subnode: sub_nodes) {
-				std::visit([&](auto & nnode){ nnode.resize(display, rect{x, r.y, width_per_win, r.h}); }, subnode);
-				x += width_per_win + config::gaps;
+				int width = (r.w - spacing_w) * weight_of(subnode) / total;
+				std::visit([&](auto & nnode){ nnode.resize(display, rect{x, r.y, width, r.h}); }, subnode);
+				x += width + config::gaps;
 				}
 		}
 
-		void layout_hsplit::resize(x11::display& display, const rect & r, std::vector<layout_node>& sub_nodes) {
+		template <typename Display>
+		void layout_hsplit::resize(Display& display, const rect & r, std::vector<layout_node>& sub_nodes) {
 			if(sub_nodes.empty()) { return; }
 			int spacing_h = static_cast<int>(sub_nodes.size() - 1) * config::gaps;
-			int height_per_win = (r.h - spacing_h) / static_cast<int>(sub_nodes.size());
+			int total = total_weight(sub_nodes);
 			auto y = r.y;
 			for(auto & subnode: sub_nodes) {
-				std::visit([&](auto & nnode){ nnode.resize(display, rect{r.x, y, r.w, height_per_win}); }, subnode);
-				y += height_per_win + config::gaps;
+				int height = (r.h - spacing_h) * weight_of(subnode) / total;
+				std::visit([&](auto & nnode){ nnode.resize(display, rect{r.x, y, r.w, height}); }, subnode);
+				y += height + config::gaps;
 			}
 		}
 
-		template <direction dir>
-		focus_data layout_vsplit::focus(x11::display& display, const std::size_t index, std::vector<layout_node>& sub_nodes) {
+		template <direction dir, typename Display>
+		focus_data layout_vsplit::focus(Display& display, const std::size_t index, std::vector<layout_node>& sub_nodes) {
 			switch (dir) {
 				case direction::next: [[fallthrough]];
 				case direction::right:
@@ -272,8 +407,8 @@ namespace btwm {
 					return focus_data::could_not_focus;
 			}
 		}
-		template <direction dir>
-		focus_data layout_hsplit::focus(x11::display& display, const std::size_t index, std::vector<layout_node>& sub_nodes) {
+		template <direction dir, typename Display>
+		focus_data layout_hsplit::focus(Display& display, const std::size_t index, std::vector<layout_node>& sub_nodes) {
 			switch (dir) {
 				case direction::next: [[fallthrough]];
 				case direction::down:
@@ -0,0 +1,220 @@
+#ifndef BTWM_LOG_HPP
+#define BTWM_LOG_HPP
+
+#include <config.hpp>
+#include <utils.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace btwm {
+	namespace logging {
+#ifdef NDEBUG
+		constexpr auto compiled_level = log_level::warning;
+#else
+		constexpr auto compiled_level = log_level::trace;
+#endif
+
+		[[nodiscard]] constexpr auto enabled(log_subsystem s, log_level l) -> bool {
+			return l != log_level::off && l >= compiled_level && l >= config::log_threshold(s);
+		}
+
+		// fixed size; `message` has to be a string literal, it is formatted by the drain thread
+		struct record {
+			static constexpr std::size_t max_args = 4;
+			std::int64_t time_ns;
+			const char* message;
+			std::array<std::int64_t, max_args> args;
+			std::uint8_t argc;
+			log_subsystem subsystem;
+			log_level level;
+		};
+
+		// single producer (the event thread), single consumer (the drain thread)
+		template <typename T, std::size_t SIZE>
+		class ring_buffer {
+			static_assert((SIZE & (SIZE - 1)) == 0, "ring_buffer size has to be a power of two");
+
+			std::array<T, SIZE> m_data;
+			std::atomic<std::size_t> m_head = 0;
+			std::atomic<std::size_t> m_tail = 0;
+
+		public:
+			[[nodiscard]] auto try_push(const T& value) noexcept -> bool {
+				const auto head = m_head.load(std::memory_order_relaxed);
+				if (head - m_tail.load(std::memory_order_acquire) == SIZE) {
+					return false;
+				}
+				m_data[head & (SIZE - 1)] = value;
+				m_head.store(head + 1, std::memory_order_release);
+				return true;
+			}
+			[[nodiscard]] auto try_pop(T& value) noexcept -> bool {
+				const auto tail = m_tail.load(std::memory_order_relaxed);
+				if (tail == m_head.load(std::memory_order_acquire)) {
+					return false;
+				}
+				value = m_data[tail & (SIZE - 1)];
+				m_tail.store(tail + 1, std::memory_order_release);
+				return true;
+			}
+		};
+
+		[[nodiscard]] constexpr auto to_string(log_subsystem s) -> const char* {
+			switch (s) {
+				case log_subsystem::events: return "events";
+				case log_subsystem::keys:   return "keys";
+				case log_subsystem::layout: return "layout";
+				case log_subsystem::x11:    return "x11";
+			}
+			return "?";
+		}
+
+		[[nodiscard]] constexpr auto to_string(log_level l) -> const char* {
+			switch (l) {
+				case log_level::trace:   return "trace";
+				case log_level::debug:   return "debug";
+				case log_level::info:    return "info";
+				case log_level::warning: return "warning";
+				case log_level::error:   return "error";
+				case log_level::off:     return "off";
+			}
+			return "?";
+		}
+
+		class logger {
+			ring_buffer<record, 1024> m_records;
+			std::atomic<std::uint64_t> m_dropped = 0;
+			std::atomic<bool> m_running = true;
+			// set by the first push after the drain thread went to sleep, only that push wakes it
+			std::atomic<bool> m_pending = false;
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::thread m_drain;
+
+			static void print(std::FILE* out, const record& r) {
+				std::fprintf(out, "[%lld.%06lld] %s %s: ",
+						static_cast<long long>(r.time_ns / 1000000000),
+						static_cast<long long>(r.time_ns % 1000000000 / 1000),
+						to_string(r.subsystem), to_string(r.level));
+				std::size_t arg = 0;
+				for (auto c = r.message; *c; ++c) {
+					if (c[0] == '{' && c[1] == '}' && arg < r.argc) {
+						std::fprintf(out, "%lld", static_cast<long long>(r.args[arg++]));
+						++c;
+					} else {
+						std::fputc(*c, out);
+					}
+				}
+				for (; arg < r.argc; ++arg) {
+					std::fprintf(out, " %lld", static_cast<long long>(r.args[arg]));
+				}
+				std::fputc('\n', out);
+			}
+
+			void drain() {
+				record r;
+				bool wrote = false;
+				while (m_records.try_pop(r)) {
+					print(stderr, r);
+					wrote = true;
+				}
+				if (auto dropped = m_dropped.exchange(0, std::memory_order_relaxed)) {
+					std::fprintf(stderr, "[log] %llu records dropped\n", static_cast<unsigned long long>(dropped));
+					wrote = true;
+				}
+				if (wrote) {
+					std::fflush(stderr);
+				}
+			}
+
+		public:
+			// the drain thread sleeps until something is logged, an idle session causes no wakeups
+			logger(): m_drain([this] {
+					for (;;) {
+						{
+							std::unique_lock<std::mutex> lock(m_mutex);
+							m_wake.wait(lock, [this] {
+									return m_pending.load(std::memory_order_acquire) || !m_running.load(std::memory_order_acquire);
+								});
+							m_pending.store(false, std::memory_order_release);
+						}
+						const bool stop = !m_running.load(std::memory_order_acquire);
+						drain();
+						if (stop) {
+							return;
+						}
+					}
+				})
+			{ }
+			~logger() {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_running.store(false, std::memory_order_release);
+				}
+				m_wake.notify_one();
+				m_drain.join();
+			}
+			logger(const logger&) = delete;
+			logger& operator=(const logger&) = delete;
+
+			[[nodiscard]] static auto instance() -> logger& {
+				static logger l;
+				return l;
+			}
+
+			void push(const record& r) noexcept {
+				if (!m_records.try_push(r)) {
+					m_dropped.fetch_add(1, std::memory_order_relaxed);
+				}
+				if (!m_pending.exchange(true, std::memory_order_acq_rel)) {
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_wake.notify_one();
+				}
+			}
+		};
+
+		template <typename T>
+		[[nodiscard]] constexpr auto to_arg(const T& v) -> std::int64_t {
+			if constexpr (std::is_enum_v<T>) {
+				return static_cast<std::int64_t>(static_cast<std::underlying_type_t<T>>(v));
+			} else {
+				return static_cast<std::int64_t>(v);
+			}
+		}
+
+		template <log_subsystem S, log_level L, typename... Args>
+		void write(const char* message, const Args&... args) {
+			static_assert(sizeof...(Args) <= record::max_args, "too many log arguments");
+			if constexpr (enabled(S, L)) {
+				const auto now = std::chrono::steady_clock::now().time_since_epoch();
+				logger::instance().push(record{
+						std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(),
+						message,
+						{ to_arg(args)... },
+						static_cast<std::uint8_t>(sizeof...(Args)),
+						S, L });
+			}
+		}
+
+		template <log_subsystem S, typename... Args>
+		void trace(const char* message, const Args&... args) { write<S, log_level::trace>(message, args...); }
+		template <log_subsystem S, typename... Args>
+		void debug(const char* message, const Args&... args) { write<S, log_level::debug>(message, args...); }
+		template <log_subsystem S, typename... Args>
+		void info(const char* message, const Args&... args) { write<S, log_level::info>(message, args...); }
+		template <log_subsystem S, typename... Args>
+		void warning(const char* message, const Args&... args) { write<S, log_level::warning>(message, args...); }
+		template <log_subsystem S, typename... Args>
+		void error(const char* message, const Args&... args) { write<S, log_level::error>(message, args...); }
+	}
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef BTWM_PENDING_CLOSE_HPP
+#define BTWM_PENDING_CLOSE_HPP
+
+#include <x11.hpp>
+#include <config.hpp>
+
+#include <chrono>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace btwm {
+	/*
+	 * Windows that were asked to close with WM_DELETE_WINDOW. Nothing waits for them: the
+	 * main loop polls with the earliest deadline and hands out what expired. A window that
+	 * is still mapped after config::close_timeout gets a _NET_WM_PING; a client that answers
+	 * is alive (probably asking to save something) and left alone, one that does not
+	 * answer within config::ping_timeout is killed.
+	 */
+	class pending_closes {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		enum class stage {
+			deleting,
+			pinging
+		};
+
+		// false if `w` is already closing
+		bool add(const x11::window& w, clock::time_point now) {
+			return m_windows.try_emplace(w, entry{ stage::deleting, now + config::close_timeout }).second;
+		}
+
+		void remove(const x11::window& w) {
+			m_windows.erase(w);
+		}
+
+		void ping_sent(const x11::window& w, clock::time_point now) {
+			auto it = m_windows.find(w);
+			if (it != m_windows.end()) {
+				it->second = { stage::pinging, now + config::ping_timeout };
+			}
+		}
+
+		// true if `w` was waiting for this pong, it stays open
+		bool on_pong(const x11::window& w) {
+			auto it = m_windows.find(w);
+			if (it == m_windows.end() || it->second.current != stage::pinging) {
+				return false;
+			}
+			m_windows.erase(it);
+			return true;
+		}
+
+		[[nodiscard]] auto empty() const -> bool { return m_windows.empty(); }
+
+		[[nodiscard]] auto deadline() const -> std::optional<clock::time_point> {
+			std::optional<clock::time_point> earliest;
+			for (auto & [w, e] : m_windows) {
+				if (!earliest || e.deadline < *earliest) {
+					earliest = e.deadline;
+				}
+			}
+			return earliest;
+		}
+
+		// windows whose deadline passed with the stage they were in
+		[[nodiscard]] auto expired(clock::time_point now) const -> std::vector<std::pair<x11::window, stage>> {
+			std::vector<std::pair<x11::window, stage>> result;
+			for (auto & [w, e] : m_windows) {
+				if (e.deadline <= now) {
+					result.emplace_back(w, e.current);
+				}
+			}
+			return result;
+		}
+
+	private:
+		struct entry {
+			stage current;
+			clock::time_point deadline;
+		};
+
+		std::unordered_map<x11::window, entry> m_windows;
+	};
+}
+
+#endif
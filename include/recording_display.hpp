@@ -0,0 +1,323 @@
+#ifndef BTWM_RECORDING_DISPLAY_HPP
+#define BTWM_RECORDING_DISPLAY_HPP
+
+#include <x11.hpp>
+#include <utils.hpp>
+#include <event_record.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace btwm {
+	namespace x11 {
+		/*
+		 * Stands in for x11::display without an X server: requests are appended to a
+		 * log instead of being sent. Queries get the answers the recorded session got
+		 * (see answer_queries), anything that was not recorded gets an empty answer.
+		 */
+		class recording_display {
+		public:
+			enum class request_kind {
+				intern_atom,
+				select_input,
+				sync,
+				kill_client,
+				send_event,
+				configure_window,
+				grab_key,
+				create_window,
+				change_property,
+				map_window,
+				window_to_rect,
+				raise_window,
+				set_input_focus,
+				launch_app,
+				grab_keyboard,
+				ungrab_keyboard,
+				set_window_border,
+				set_border_width,
+				ungrab_key,
+				no_op,
+				count
+			};
+
+			struct request {
+				request_kind kind;
+				x11::window_base window;
+				std::array<long, 4> args;
+			};
+
+			explicit recording_display(recording::session_info info): m_info(std::move(info)) { }
+
+			[[nodiscard]] auto default_root_window() -> x11::window { return m_info.root; }
+			[[nodiscard]] auto make_atom_only_if_exists(const char* name) -> x11::atom { return make_atom_always(name); }
+			[[nodiscard]] auto make_atom_always(const char* name) -> x11::atom {
+				log(request_kind::intern_atom, 0, 1);
+				return lookup_atom(name);
+			}
+			template <std::size_t N>
+			[[nodiscard]] auto intern_atoms(const std::array<const char*, N>& names) -> std::array<x11::atom, N> {
+				std::array<x11::atom, N> atoms;
+				for(std::size_t i = 0; i < N; ++i) {
+					atoms[i] = lookup_atom(names[i]);
+				}
+				log(request_kind::intern_atom, 0, static_cast<long>(N));
+				return atoms;
+			}
+			[[nodiscard]] auto keysym_to_keycode(const x11::key_sym& s) -> x11::key_code {
+				for(auto & [code, sym] : m_info.keymap) {
+					if(sym == static_cast<x11::key_sym_base>(s)) {
+						return code;
+					}
+				}
+				return x11::key_code{};
+			}
+			auto set_error_handler(x11::error_handler) -> void { }
+			auto select_input(const x11::window& w, const x11::event_mask& m) -> void {
+				log(request_kind::select_input, w, static_cast<long>(m));
+			}
+			auto sync(bool discard) -> void { log(request_kind::sync, 0, discard); }
+			[[nodiscard]] auto is_protocoll_supported(const x11::window& w, const x11::atom& atm) -> bool {
+				auto r = find_reply(x11::query::protocol, w, atm);
+				return r && !r->values.empty() && r->values.front() != 0;
+			}
+			void kill_client(const x11::window& w) { log(request_kind::kill_client, w); }
+			auto send_event(const x11::window& w, bool propagate, const event_mask& ev_mask, x11::events::event& event) {
+				log(request_kind::send_event, w, propagate, static_cast<long>(ev_mask), event.type);
+				return 1;
+			}
+			auto default_screen() const -> x11::screen_index { return 0; }
+			auto display_width(const x11::screen_index&) const { return m_info.width; }
+			auto display_height(const x11::screen_index&) const { return m_info.height; }
+			[[nodiscard]] auto alloc_color(const char*) -> x11::pixel { return 0; }
+			auto set_window_border(const x11::window& w, x11::pixel p) {
+				log(request_kind::set_window_border, w, static_cast<long>(p));
+			}
+			auto set_border_width(const x11::window& w, unsigned int width) {
+				log(request_kind::set_border_width, w, static_cast<long>(width));
+			}
+			auto configure_window(const x11::window& w, unsigned int value_mask, x11::window_changes changes) {
+				log(request_kind::configure_window, w, value_mask, changes.x, changes.y, changes.width);
+			}
+			auto grab_key(const key_match& k, const x11::window& w, const bool, x11::grab_mode, x11::grab_mode) {
+				log(request_kind::grab_key, w, static_cast<long>(k.key_code),
+						static_cast<long>(k.include_mask), static_cast<long>(k.exclude_mask));
+			}
+			auto ungrab_key(const key_match& k, const x11::window& w) {
+				log(request_kind::ungrab_key, w, static_cast<long>(k.key_code),
+						static_cast<long>(k.include_mask), static_cast<long>(k.exclude_mask));
+			}
+			// replays keep the keyboard mapping of the recorded session
+			auto refresh_keyboard_mapping(x11::events::mapping&) -> void { }
+			auto grab_keyboard(const x11::window& w, x11::time t) -> bool {
+				log(request_kind::grab_keyboard, w, static_cast<long>(t));
+				return true;
+			}
+			auto ungrab_keyboard(x11::time t) -> void { log(request_kind::ungrab_keyboard, 0, static_cast<long>(t)); }
+			auto create_window(const x11::window& parent, const btwm::rect& r) -> x11::window {
+				log(request_kind::create_window, parent, r.x, r.y, r.w, r.h);
+				// ids in the range of the window manager's own connection
+				return static_cast<x11::window>(0x200000 + m_created_windows++);
+			}
+			auto change_property(const x11::window& w, const x11::atom& property, const x11::atom& type,
+					x11::prop_mode mode, btwm::array_view<const long> data) {
+				log(request_kind::change_property, w, static_cast<long>(property), static_cast<long>(type),
+						static_cast<long>(mode), static_cast<long>(data.size()));
+			}
+			auto change_property(const x11::window& w, const x11::atom& property, const x11::atom& type,
+					x11::prop_mode mode, const std::string& data) {
+				log(request_kind::change_property, w, static_cast<long>(property), static_cast<long>(type),
+						static_cast<long>(mode), static_cast<long>(data.size()));
+			}
+			// the replies recorded while the current event was handled, each answers one query
+			void answer_queries(const std::vector<x11::reply>& replies) {
+				m_replies.assign(replies.begin(), replies.end());
+				m_answered.assign(replies.size(), false);
+			}
+			[[nodiscard]] auto get_property(const x11::window& w, const x11::atom& property, const x11::atom&) -> std::vector<long> {
+				auto r = find_reply(x11::query::property, w, property);
+				return r ? r->values : std::vector<long>{};
+			}
+			[[nodiscard]] auto get_text_property(const x11::window& w, const x11::atom& property, const x11::atom&) -> std::string {
+				auto r = find_reply(x11::query::text_property, w, property);
+				return r ? r->text : std::string{};
+			}
+			[[nodiscard]] auto get_transient_for(const x11::window& w) -> std::optional<x11::window> {
+				auto r = find_reply(x11::query::transient_for, w, x11::atom{});
+				if(!r || r->values.empty()) {
+					return std::nullopt;
+				}
+				return static_cast<x11::window>(r->values.front());
+			}
+			[[nodiscard]] auto get_normal_hints(const x11::window& w) -> std::optional<x11::normal_hints> {
+				auto r = find_reply(x11::query::wm_normal_hints, w, x11::atom{});
+				if(!r || r->text.size() != sizeof(x11::normal_hints)) {
+					return std::nullopt;
+				}
+				x11::normal_hints hints;
+				std::memcpy(&hints, r->text.data(), sizeof(hints));
+				return hints;
+			}
+			[[nodiscard]] auto get_class_hint(const x11::window& w) -> x11::class_hint {
+				auto r = find_reply(x11::query::class_hint, w, x11::atom{});
+				if(!r) {
+					return {};
+				}
+				const auto split = r->text.find('\0');
+				if(split == std::string::npos) {
+					return { r->text, {} };
+				}
+				return { r->text.substr(0, split), r->text.substr(split + 1) };
+			}
+			[[nodiscard]] auto get_geometry(const x11::window& w) -> std::optional<btwm::rect> {
+				auto r = find_reply(x11::query::geometry, w, x11::atom{});
+				if(!r || r->values.size() != 4) {
+					return std::nullopt;
+				}
+				return btwm::rect{ static_cast<int>(r->values[0]), static_cast<int>(r->values[1]),
+					static_cast<int>(r->values[2]), static_cast<int>(r->values[3]) };
+			}
+			// replays feed one event at a time, only what the recorded handler coalesced is queued behind it
+			void queue_events(const std::vector<x11::events::event>& events) {
+				m_queue.assign(events.begin(), events.end());
+			}
+			[[nodiscard]] auto queued() -> int { return static_cast<int>(m_queue.size()); }
+			[[nodiscard]] auto peek_event() -> x11::events::event { return m_queue.empty() ? x11::events::event{} : m_queue.front(); }
+			[[nodiscard]] auto next_event() -> x11::events::event {
+				if(m_queue.empty()) {
+					return {};
+				}
+				auto e = m_queue.front();
+				m_queue.pop_front();
+				return e;
+			}
+			auto set_detectable_autorepeat() -> bool { return true; }
+			// replays run without frame synchronization
+			[[nodiscard]] auto init_sync_extension() -> std::optional<int> { return std::nullopt; }
+			[[nodiscard]] auto query_counter(const x11::sync_counter& counter) -> std::optional<std::int64_t> {
+				auto r = find_reply(x11::query::counter_value, static_cast<x11::window>(counter), x11::atom{});
+				if(!r || r->values.empty()) {
+					return std::nullopt;
+				}
+				return static_cast<std::int64_t>(r->values.front());
+			}
+			[[nodiscard]] auto create_alarm(const x11::sync_counter&, std::int64_t) -> x11::sync_alarm { return x11::sync_alarm{}; }
+			auto change_alarm(const x11::sync_alarm&, std::int64_t) { }
+			auto destroy_alarm(const x11::sync_alarm&) { }
+			auto map_window(const x11::window& w) { log(request_kind::map_window, w); }
+			auto window_to_rect(const x11::window& w, const btwm::rect& r) {
+				log(request_kind::window_to_rect, w, r.x, r.y, r.w, r.h);
+			}
+			auto no_op() { log(request_kind::no_op, 0); }
+			auto raise_window(const x11::window& w) { log(request_kind::raise_window, w); }
+			auto set_input_focus(const x11::window& w, x11::revert_to rev, x11::time t) {
+				log(request_kind::set_input_focus, w, static_cast<long>(rev), static_cast<long>(t));
+			}
+			void launch_app(std::string, btwm::array_view<std::string> args) {
+				log(request_kind::launch_app, 0, static_cast<long>(args.size()));
+			}
+
+			[[nodiscard]] auto request_count() const -> unsigned long { return m_requests.size(); }
+			[[nodiscard]] auto requests() const -> const std::vector<request>& { return m_requests; }
+			void clear() { m_requests.clear(); }
+
+			// the recorded time of what is replayed next, now() answers with it
+			void set_time(std::chrono::nanoseconds t) { m_now = std::chrono::steady_clock::time_point(t); }
+			[[nodiscard]] auto now() const -> std::chrono::steady_clock::time_point { return m_now; }
+
+			[[nodiscard]] static constexpr auto to_string(request_kind k) -> const char* {
+				switch(k) {
+					case request_kind::intern_atom:      return "intern_atom";
+					case request_kind::select_input:     return "select_input";
+					case request_kind::sync:             return "sync";
+					case request_kind::kill_client:      return "kill_client";
+					case request_kind::send_event:       return "send_event";
+					case request_kind::configure_window: return "configure_window";
+					case request_kind::grab_key:         return "grab_key";
+					case request_kind::create_window:    return "create_window";
+					case request_kind::change_property:  return "change_property";
+					case request_kind::map_window:       return "map_window";
+					case request_kind::window_to_rect:   return "window_to_rect";
+					case request_kind::raise_window:     return "raise_window";
+					case request_kind::set_input_focus:  return "set_input_focus";
+					case request_kind::launch_app:       return "launch_app";
+					case request_kind::grab_keyboard:    return "grab_keyboard";
+					case request_kind::ungrab_keyboard:  return "ungrab_keyboard";
+					case request_kind::set_window_border: return "set_window_border";
+					case request_kind::set_border_width: return "set_border_width";
+					case request_kind::ungrab_key:       return "ungrab_key";
+					case request_kind::no_op:            return "no_op";
+					case request_kind::count:            break;
+				}
+				return "?";
+			}
+
+			// one line per request, stable across builds so that two replays can be diffed
+			void dump(std::ostream& out) const {
+				for(auto & r : m_requests) {
+					out << to_string(r.kind) << " 0x" << std::hex << r.window << std::dec;
+					for(auto a : r.args) {
+						out << ' ' << a;
+					}
+					out << '\n';
+				}
+			}
+
+		private:
+			// the first recorded reply to the same query that was not used yet
+			[[nodiscard]] auto find_reply(x11::query kind, const x11::window& w, const x11::atom& property) -> const x11::reply* {
+				for(std::size_t i = 0; i < m_replies.size(); ++i) {
+					const auto& r = m_replies[i];
+					if(!m_answered[i] && r.kind == kind && r.window == w && r.property == property) {
+						m_answered[i] = true;
+						return &r;
+					}
+				}
+				return nullptr;
+			}
+
+			// the recorded server's id if the session has it, else an id above the predefined atoms of the core protocol
+			[[nodiscard]] auto lookup_atom(const char* name) -> x11::atom {
+				for(auto & [recorded, id] : m_info.atoms) {
+					if(recorded == name) {
+						return id;
+					}
+				}
+				auto it = std::find(m_atoms.begin(), m_atoms.end(), name);
+				if(it == m_atoms.end()) {
+					it = m_atoms.insert(it, name);
+				}
+				return static_cast<x11::atom>(XA_LAST_PREDEFINED + 1 + static_cast<x11::atom_base>(it - m_atoms.begin()));
+			}
+
+			template <typename... Args>
+			void log(request_kind kind, x11::window w, Args... args) {
+				log(kind, static_cast<x11::window_base>(w), args...);
+			}
+			template <typename... Args>
+			void log(request_kind kind, x11::window_base w, Args... args) {
+				m_requests.push_back({ kind, w, { static_cast<long>(args)... } });
+			}
+
+			recording::session_info m_info;
+			std::vector<std::string> m_atoms;
+			x11::window_base m_created_windows = 0;
+			std::vector<request> m_requests;
+			std::deque<x11::events::event> m_queue;
+			std::vector<x11::reply> m_replies;
+			std::vector<bool> m_answered;
+			std::chrono::steady_clock::time_point m_now{};
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef BTWM_RULES_HPP
+#define BTWM_RULES_HPP
+
+#include <x11.hpp>
+#include <utils.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace btwm {
+	namespace rules {
+		// everything the rules can match on, read once when a window is mapped
+		struct window_properties {
+			x11::class_hint class_hint;
+			std::string title;
+			std::string role;
+			// _NET_WM_WINDOW_TYPE atoms, most preferred first
+			std::vector<long> window_type;
+		};
+
+		/*
+		 * The rules compiled into one hash table per property. Every rule is indexed under
+		 * its class, else instance, role or title, so matching a window is at most four
+		 * lookups no matter how many rules there are. Title and role are only fetched from
+		 * the server if at least one rule looks at them.
+		 */
+		class matcher {
+		public:
+			explicit matcher(array_view<const rule> rules): m_rules(rules.begin(), rules.end()) {
+				for(std::size_t i = 0; i < m_rules.size(); ++i) {
+					const auto& r = m_rules[i];
+					m_needs_title |= r.title != nullptr;
+					m_needs_role |= r.role != nullptr;
+					if(r.window_class)  { m_by_class[r.window_class].push_back(i); }
+					else if(r.instance) { m_by_instance[r.instance].push_back(i); }
+					else if(r.role)     { m_by_role[r.role].push_back(i); }
+					else if(r.title)    { m_by_title[r.title].push_back(i); }
+					else                { m_any.push_back(i); }
+				}
+			}
+
+			[[nodiscard]] auto needs_title() const -> bool { return m_needs_title; }
+			[[nodiscard]] auto needs_role() const -> bool { return m_needs_role; }
+
+			// first rule in config order that matches, nullptr if there is none
+			[[nodiscard]] auto match(const window_properties& p) const -> const rule* {
+				auto best = std::numeric_limits<std::size_t>::max();
+				auto consider = [&](const std::vector<std::size_t>& candidates) {
+					for(auto i : candidates) {
+						if(i < best && matches(m_rules[i], p)) {
+							best = i;
+						}
+					}
+				};
+				auto lookup = [&](const index& idx, const std::string& key) {
+					auto it = idx.find(key);
+					if(it != idx.end()) {
+						consider(it->second);
+					}
+				};
+				lookup(m_by_class, p.class_hint.name);
+				lookup(m_by_instance, p.class_hint.instance);
+				lookup(m_by_role, p.role);
+				lookup(m_by_title, p.title);
+				consider(m_any);
+				return best < m_rules.size() ? &m_rules[best] : nullptr;
+			}
+
+		private:
+			using index = std::unordered_map<std::string, std::vector<std::size_t>>;
+
+			[[nodiscard]] static auto matches(const rule& r, const window_properties& p) -> bool {
+				auto field = [](const char* expected, const std::string& actual) {
+					return expected == nullptr || actual == expected;
+				};
+				return field(r.window_class, p.class_hint.name) && field(r.instance, p.class_hint.instance) &&
+					field(r.title, p.title) && field(r.role, p.role);
+			}
+
+			std::vector<rule> m_rules;
+			index m_by_class;
+			index m_by_instance;
+			index m_by_role;
+			index m_by_title;
+			std::vector<std::size_t> m_any;
+			bool m_needs_title = false;
+			bool m_needs_role = false;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef BTWM_STATUS_PAGE_HPP
+#define BTWM_STATUS_PAGE_HPP
+
+#include <x11.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+/*
+ * Window manager state in a POSIX shared memory object (/dev/shm/btwm...), for bars and
+ * pagers that want it without round trips to the X server or the control socket.
+ * The page is a seqlock: readers map it read-only and retry while `sequence` is odd or
+ * changed during their copy,
+ *
+ *     do {
+ *         seq = load_acquire(&page->sequence);
+ *         copy = *page;
+ *         atomic_thread_fence(acquire);
+ *     } while ((seq & 1) || seq != load_relaxed(&page->sequence));
+ *
+ * The window manager only writes when something in the page changed.
+ */
+
+namespace btwm {
+	namespace status {
+		constexpr std::uint32_t page_magic = 0x6d777462; // "btwm"
+		constexpr std::uint32_t page_version = 1;
+
+		enum class layout_mode: std::uint32_t {
+			vsplit = 0,
+			hsplit = 1
+		};
+
+		struct page {
+			static constexpr std::size_t max_title = 256;
+			static constexpr std::size_t max_windows = 256;
+
+			std::atomic<std::uint32_t> sequence;
+			std::uint32_t magic;
+			std::uint32_t version;
+			layout_mode layout;
+			std::uint64_t focused;
+			std::uint32_t window_count;
+			char focused_title[max_title];
+			std::uint64_t windows[max_windows];
+		};
+		static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "the seqlock needs a lock-free counter");
+
+		// what ends up in the page
+		struct snapshot {
+			x11::window focused{};
+			std::string title;
+			layout_mode layout = layout_mode::vsplit;
+			std::vector<long> windows;
+
+			bool operator==(const snapshot& o) const {
+				return focused == o.focused && layout == o.layout && title == o.title && windows == o.windows;
+			}
+			bool operator!=(const snapshot& o) const { return !(*this == o); }
+		};
+
+		[[nodiscard]] inline auto default_page_name() -> std::string {
+			const char* display = std::getenv("DISPLAY");
+			std::string name = "/btwm-" + std::to_string(getuid()) + (display ? display : ":0");
+			std::replace(name.begin() + 1, name.end(), '/', '_');
+			return name;
+		}
+
+		class page_writer {
+		public:
+			explicit page_writer(std::string name): m_name(std::move(name)) {
+				// the name is predictable: a page left behind by a crashed run of ours goes away
+				// (/dev/shm is sticky, pages of other users stay), then only a new one is used
+				shm_unlink(m_name.c_str());
+				int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+				if(fd < 0) {
+					throw std::runtime_error("could not create status page " + m_name);
+				}
+				if(ftruncate(fd, sizeof(page)) < 0) {
+					close(fd);
+					shm_unlink(m_name.c_str());
+					throw std::runtime_error("could not size status page " + m_name);
+				}
+				void* mem = mmap(nullptr, sizeof(page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				close(fd);
+				if(mem == MAP_FAILED) {
+					shm_unlink(m_name.c_str());
+					throw std::runtime_error("could not map status page " + m_name);
+				}
+				m_page = new(mem) page{};
+				m_page->magic = page_magic;
+				m_page->version = page_version;
+			}
+			~page_writer() {
+				munmap(m_page, sizeof(page));
+				shm_unlink(m_name.c_str());
+			}
+			page_writer(const page_writer&) = delete;
+			page_writer& operator=(const page_writer&) = delete;
+
+			[[nodiscard]] auto name() const -> const std::string& { return m_name; }
+
+			// false if nothing changed and the page was left alone
+			bool write(const snapshot& s) {
+				if(s == m_last) {
+					return false;
+				}
+				const auto seq = m_page->sequence.load(std::memory_order_relaxed);
+				m_page->sequence.store(seq + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+
+				m_page->layout = s.layout;
+				m_page->focused = static_cast<std::uint64_t>(s.focused);
+				const auto title_length = std::min(s.title.size(), page::max_title - 1);
+				std::copy_n(s.title.data(), title_length, m_page->focused_title);
+				m_page->focused_title[title_length] = '\0';
+				const auto count = std::min(s.windows.size(), page::max_windows);
+				std::copy_n(s.windows.begin(), count, m_page->windows);
+				m_page->window_count = static_cast<std::uint32_t>(count);
+
+				m_page->sequence.store(seq + 2, std::memory_order_release);
+				m_last = s;
+				return true;
+			}
+
+		private:
+			std::string m_name;
+			page* m_page = nullptr;
+			snapshot m_last;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef BTWM_STRUTS_HPP
+#define BTWM_STRUTS_HPP
+
+#include <x11.hpp>
+#include <utils.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace btwm {
+	// space a dock reserves at each screen edge
+	struct strut {
+		long left = 0;
+		long right = 0;
+		long top = 0;
+		long bottom = 0;
+
+		bool operator==(const strut& o) const {
+			return left == o.left && right == o.right && top == o.top && bottom == o.bottom;
+		}
+		bool operator!=(const strut& o) const { return !(*this == o); }
+	};
+
+	// the first four values of _NET_WM_STRUT_PARTIAL and _NET_WM_STRUT are the same
+	[[nodiscard]] inline auto parse_strut(const std::vector<long>& values) -> strut {
+		if (values.size() < 4) {
+			return {};
+		}
+		return { std::max(0L, values[0]), std::max(0L, values[1]), std::max(0L, values[2]), std::max(0L, values[3]) };
+	}
+
+	/*
+	 * Union of the struts of all docks. Every change reports whether the reserved area
+	 * moved, so a dock that appears, updates or goes away without changing what is
+	 * reserved costs no relayout.
+	 */
+	class reserved_area {
+	public:
+		[[nodiscard]] auto contains(const x11::window& w) const -> bool { return m_docks.count(w) != 0; }
+
+		// true if the reserved area changed
+		bool set(const x11::window& w, const strut& s) {
+			auto it = m_docks.find(w);
+			if (it != m_docks.end() && it->second == s) {
+				return false;
+			}
+			m_docks.insert_or_assign(w, s);
+			return update();
+		}
+
+		// true if the reserved area changed
+		bool remove(const x11::window& w) {
+			if (m_docks.erase(w) == 0) {
+				return false;
+			}
+			return update();
+		}
+
+		[[nodiscard]] auto reserved() const -> const strut& { return m_reserved; }
+
+		[[nodiscard]] auto apply(const rect& screen) const -> rect {
+			return {
+				screen.x + static_cast<int>(m_reserved.left),
+				screen.y + static_cast<int>(m_reserved.top),
+				std::max(0, screen.w - static_cast<int>(m_reserved.left + m_reserved.right)),
+				std::max(0, screen.h - static_cast<int>(m_reserved.top + m_reserved.bottom))
+			};
+		}
+
+	private:
+		bool update() {
+			strut total;
+			for (auto & [w, s] : m_docks) {
+				total.left = std::max(total.left, s.left);
+				total.right = std::max(total.right, s.right);
+				total.top = std::max(total.top, s.top);
+				total.bottom = std::max(total.bottom, s.bottom);
+			}
+			if (total == m_reserved) {
+				return false;
+			}
+			m_reserved = total;
+			return true;
+		}
+
+		std::unordered_map<x11::window, strut> m_docks;
+		strut m_reserved;
+	};
+}
+
+#endif
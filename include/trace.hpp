@@ -0,0 +1,120 @@
+#ifndef BTWM_TRACE_HPP
+#define BTWM_TRACE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+}
+
+/*
+ * Spans of the event thread in Chrome trace-event format, for chrome://tracing or
+ * ui.perfetto.dev. Started and stopped through the control socket ("trace start",
+ * "trace stop FILE"); while stopped a span costs one branch. The buffer is allocated
+ * once and keeps the newest max_events spans, so a long session still shows the
+ * moments before the stop.
+ */
+
+namespace btwm {
+	namespace tracing {
+		// `name` and `arg_name` have to be string literals
+		struct event {
+			const char* name;
+			const char* arg_name;
+			std::int64_t arg;
+			std::int64_t begin_ns;
+			std::int64_t duration_ns;
+		};
+
+		[[nodiscard]] inline auto now_ns() -> std::int64_t {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// only used from the event thread
+		class recorder {
+		public:
+			static constexpr std::size_t max_events = 1 << 16;
+
+			[[nodiscard]] static auto instance() -> recorder& {
+				static recorder r;
+				return r;
+			}
+
+			[[nodiscard]] auto enabled() const -> bool { return m_enabled; }
+
+			void start() {
+				if (m_events.empty()) {
+					m_events.resize(max_events);
+				}
+				m_next = 0;
+				m_enabled = true;
+			}
+
+			// writes the buffered spans to `path` and returns how many
+			auto stop(const std::string& path) -> std::size_t {
+				m_enabled = false;
+				std::FILE* out = std::fopen(path.c_str(), "w");
+				if (!out) {
+					throw std::runtime_error("could not open " + path);
+				}
+				const auto count = m_next < max_events ? m_next : max_events;
+				const auto pid = static_cast<long>(getpid());
+				std::fputs("{\"traceEvents\":[\n", out);
+				for (std::size_t i = m_next - count; i < m_next; ++i) {
+					const auto& e = m_events[i & (max_events - 1)];
+					std::fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%ld,\"tid\":1,\"ts\":%lld.%03lld,\"dur\":%lld.%03lld",
+							i == m_next - count ? "" : ",\n", e.name, pid,
+							static_cast<long long>(e.begin_ns / 1000), static_cast<long long>(e.begin_ns % 1000),
+							static_cast<long long>(e.duration_ns / 1000), static_cast<long long>(e.duration_ns % 1000));
+					if (e.arg_name) {
+						std::fprintf(out, ",\"args\":{\"%s\":%lld}", e.arg_name, static_cast<long long>(e.arg));
+					}
+					std::fputc('}', out);
+				}
+				std::fputs("\n]}\n", out);
+				std::fclose(out);
+				return count;
+			}
+
+			void add(const event& e) {
+				m_events[m_next++ & (max_events - 1)] = e;
+			}
+
+		private:
+			recorder() = default;
+
+			std::vector<event> m_events;
+			std::size_t m_next = 0;
+			bool m_enabled = false;
+		};
+
+		// records the time until it goes out of scope, if tracing was on when it was created
+		class span {
+		public:
+			explicit span(const char* name, const char* arg_name = nullptr):
+				m_event{ name, arg_name, 0, recorder::instance().enabled() ? now_ns() : 0, 0 }
+			{ }
+			~span() {
+				if (m_event.begin_ns != 0 && recorder::instance().enabled()) {
+					m_event.duration_ns = now_ns() - m_event.begin_ns;
+					recorder::instance().add(m_event);
+				}
+			}
+			span(const span&) = delete;
+			span& operator=(const span&) = delete;
+
+			void set_arg(std::int64_t value) { m_event.arg = value; }
+
+		private:
+			event m_event;
+		};
+	}
+}
+
+#endif
@@ -8,9 +8,147 @@
 
 namespace btwm {
 	inline namespace utils {
+		enum class direction {
+			up,
+			down,
+			left,
+			right,
+			next,
+			prev,
+		};
+
+		enum class split_type {
+			horizontal,
+			vertical,
+			toggle
+		};
+
+		// key bindings, see config::bindings
+		enum class key_action {
+			focus,
+			move,
+			resize,
+			split,
+			kill,
+			spawn,
+			mode,
+			quit
+		};
+		struct key_command {
+			key_action action;
+			direction dir = direction::next;
+			split_type split = split_type::toggle;
+			// program for spawn, mode name for mode
+			const char* arg = nullptr;
+		};
+		namespace commands {
+			constexpr auto focus(direction d) -> key_command { return { key_action::focus, d }; }
+			constexpr auto move(direction d) -> key_command { return { key_action::move, d }; }
+			constexpr auto resize(direction d) -> key_command { return { key_action::resize, d }; }
+			constexpr auto split(split_type s) -> key_command { return { key_action::split, direction::next, s }; }
+			constexpr auto kill() -> key_command { return { key_action::kill }; }
+			constexpr auto spawn(const char* program) -> key_command { return { key_action::spawn, direction::next, split_type::toggle, program }; }
+			constexpr auto mode(const char* name) -> key_command { return { key_action::mode, direction::next, split_type::toggle, name }; }
+			constexpr auto quit() -> key_command { return { key_action::quit }; }
+		}
+		struct key_mode {
+			const char* name;
+			// leaves the mode after the first key, for chords
+			bool oneshot;
+		};
+		struct key_binding {
+			const char* mode;
+			unsigned int modifiers;
+			unsigned long keysym;
+			key_command command;
+		};
+
+		// placement rules, see config::rules
+		enum class rule_floating {
+			automatic,
+			floating,
+			tiled
+		};
+		enum class rule_split {
+			none,
+			horizontal,
+			vertical
+		};
+		struct rule {
+			// matched exactly, nullptr matches anything
+			const char* window_class = nullptr;
+			const char* instance = nullptr;
+			const char* title = nullptr;
+			const char* role = nullptr;
+
+			rule_floating floating = rule_floating::automatic;
+			// wraps the new window and the one it is placed beside in a new container
+			rule_split split = rule_split::none;
+			// WM_CLASS of a tiled window to place the new one beside, else the focused one if split is set
+			const char* target = nullptr;
+		};
+
 		struct rect {
 			int x,y,w,h;
 		};
+		[[nodiscard]] constexpr auto operator == (const rect& a, const rect& b) -> bool {
+			return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+		}
+		[[nodiscard]] constexpr auto operator != (const rect& a, const rect& b) -> bool { return !(a == b); }
+
+		enum class log_level: std::uint8_t {
+			trace,
+			debug,
+			info,
+			warning,
+			error,
+			off
+		};
+
+		enum class log_subsystem: std::uint8_t {
+			events,
+			keys,
+			layout,
+			x11
+		};
+
+		template <typename T>
+		struct intrusive_list_hook {
+			T* prev = nullptr;
+			T* next = nullptr;
+		};
+
+		// doubly linked list threaded through a member hook, the list never owns its elements
+		template <typename T, intrusive_list_hook<T> T::*Hook>
+		class intrusive_list {
+			T* m_front = nullptr;
+			T* m_back = nullptr;
+
+			[[nodiscard]] static auto hook(T& value) noexcept -> intrusive_list_hook<T>& { return value.*Hook; }
+
+		public:
+			[[nodiscard]] auto empty() const noexcept -> bool { return m_front == nullptr; }
+			[[nodiscard]] auto front() const noexcept -> T* { return m_front; }
+			[[nodiscard]] auto back() const noexcept -> T* { return m_back; }
+			[[nodiscard]] static auto next(const T& value) noexcept -> T* { return (value.*Hook).next; }
+
+			void push_back(T& value) noexcept {
+				hook(value) = { m_back, nullptr };
+				(m_back ? hook(*m_back).next : m_front) = &value;
+				m_back = &value;
+			}
+			void push_front(T& value) noexcept {
+				hook(value) = { nullptr, m_front };
+				(m_front ? hook(*m_front).prev : m_back) = &value;
+				m_front = &value;
+			}
+			void unlink(T& value) noexcept {
+				auto & h = hook(value);
+				(h.prev ? hook(*h.prev).next : m_front) = h.next;
+				(h.next ? hook(*h.next).prev : m_back) = h.prev;
+				h = {};
+			}
+		};
 
 		template <typename T>
 		class array_view
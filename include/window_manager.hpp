@@ -0,0 +1,1113 @@
+#ifndef BTWM_WINDOW_MANAGER_HPP
+#define BTWM_WINDOW_MANAGER_HPP
+
+#include <config.hpp>
+#include <x11.hpp>
+#include <utils.hpp>
+#include <layouts.hpp>
+#include <log.hpp>
+#include <event_record.hpp>
+#include <ipc.hpp>
+#include <ewmh.hpp>
+#include <frame_sync.hpp>
+#include <floating.hpp>
+#include <rules.hpp>
+#include <struts.hpp>
+#include <trace.hpp>
+#include <status_page.hpp>
+#include <bindings.hpp>
+#include <pending_close.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+extern "C" {
+#include <poll.h>
+}
+
+namespace btwm {
+	template <typename Display>
+	class basic_window_manager {
+
+	public:
+		template <typename... Args>
+		static std::unique_ptr<basic_window_manager> create(Args&&... display_args) {
+			return std::make_unique<basic_window_manager>(std::forward<Args>(display_args)...);
+		}
+		~basic_window_manager() { }
+		template <typename... Args>
+		explicit basic_window_manager(Args&&... display_args):
+			m_display(std::forward<Args>(display_args)...),
+			m_root(m_display.default_root_window()),
+			atoms(m_display),
+			m_keys(m_display,
+				btwm::array_view<const key_mode>(config::modes.data(), config::modes.size()),
+				btwm::array_view<const key_binding>(config::bindings.data(), config::bindings.size()))
+		{
+			detect_other_wm();
+			m_display.select_input(m_root, x11::event_mask::substructure_redirect | x11::event_mask::substructure_notify);
+			m_display.sync(false);
+			m_display.set_error_handler([](x11::display_base *display, x11::events::error *e) -> int{
+					const int MAX_ERROR_TEXT_LENGTH = 1024;
+					char error_text[MAX_ERROR_TEXT_LENGTH];
+					XGetErrorText(display, e->error_code, error_text, sizeof(error_text));
+					std::cerr << "Received X error:\n"
+					<< "    Request: " << int(e->request_code)
+					// << " - " << XRequestCodeToString(e->request_code) << "\n"
+					<< "    Error code: " << int(e->error_code)
+					<< " - " << error_text << "\n"
+					<< "    Resource ID: " << e->resourceid;
+					// The return value is ignored.
+					return 0;
+				});
+			m_ewmh.emplace(m_display, m_root, atoms);
+			if (auto event_base = m_display.init_sync_extension()) {
+				m_sync.emplace(*event_base);
+			}
+			if (!m_display.set_detectable_autorepeat()) {
+				logging::warning<log_subsystem::keys>("no detectable autorepeat, held keys are only coalesced");
+			}
+			screen_rect = get_screen_rect();
+			content_rect = get_content_rect();
+			m_keys.grab(m_display, m_root);
+			m_focused_pixel = m_display.alloc_color(config::focused_border_color);
+			m_unfocused_pixel = m_display.alloc_color(config::unfocused_border_color);
+		}
+
+		int run() {
+			std::vector<pollfd> fds;
+
+			for(;;) {
+				while(m_display.pending() > 0) {
+					auto e = next_event(false);
+					if(handle_event(e)) {
+						if(m_recorder) {
+							m_recorder->flush();
+						}
+						// not a log record, release builds compile those out and the stress harness reads this line
+						std::cerr << "btwm: quit after " << m_display.request_count() << " X requests" << std::endl;
+						return 0;
+					}
+				}
+				if(m_status && m_status_dirty) {
+					update_status();
+				}
+				{
+					tracing::span span("flush", "requests");
+					span.set_arg(static_cast<std::int64_t>(m_display.request_count() - m_flushed_requests));
+					m_display.flush();
+					m_flushed_requests = m_display.request_count();
+				}
+
+				fds.clear();
+				fds.push_back({ m_display.connection_fd(), POLLIN, 0 });
+				if(m_ipc) {
+					m_ipc->poll_fds(fds);
+				}
+				if(poll(fds.data(), fds.size(), next_timeout()) < 0) {
+					if(errno == EINTR) {
+						continue;
+					}
+					throw std::runtime_error("poll failed");
+				}
+				on_timers();
+				if(m_ipc) {
+					m_ipc->dispatch(fds, 1, [&](const std::vector<ipc::command>& batch, const std::string& line) {
+							return handle_batch(batch, line);
+						});
+				}
+			}
+		}
+
+		// accepts control connections on `path`, see ipc.hpp for the protocol; the window
+		// manager also runs without it
+		void listen(const std::string& path) {
+			try {
+				m_ipc.emplace(path);
+			}
+			catch(const std::runtime_error&) {
+				logging::warning<log_subsystem::events>("could not open the ipc socket, running without it");
+				return;
+			}
+			setenv("BTWM_SOCKET", path.c_str(), 1);
+		}
+
+		// keeps the shared memory object `name` up to date, see status_page.hpp for the layout;
+		// the window manager also runs without it
+		void share_status(const std::string& name) {
+			try {
+				m_status.emplace(name);
+			}
+			catch(const std::runtime_error&) {
+				logging::warning<log_subsystem::events>("could not create the status page, running without it");
+				return;
+			}
+			m_status_dirty = true;
+		}
+
+		// writes every event the window manager dequeues and every query answer to `path`, see btwm_replay
+		void record_events(const std::string& path) {
+			m_recorder.emplace(path, recording::capture_session(m_display));
+			m_display.log_replies([this](const x11::reply& r) { m_recorder->write(r); });
+		}
+
+		// dispatches a single event, true if the window manager should quit
+		bool handle_event(const x11::events::event& e) {
+			switch(e.type) {
+				case CreateNotify: break;
+				case DestroyNotify: break;
+				case ReparentNotify: break;
+				case ButtonPress: break;
+				case ConfigureRequest:
+					on_configure_request(e.xconfigurerequest);
+					break;
+				case MapRequest:
+					on_map_request(e.xmaprequest);
+					break;
+				case UnmapNotify:
+					on_unmap(e.xunmap);
+					break;
+				case KeyPress:
+					if( !is_dropped_repeat(e.xkey) && on_key_press(e.xkey) ) {
+						return true;
+					}
+					break;
+				case KeyRelease:
+					on_key_release(e.xkey);
+					break;
+				case FocusIn:
+					on_focus_in(e.xfocus);
+					break;
+				case FocusOut:
+					on_focus_out(e.xfocus);
+					break;
+				case PropertyNotify:
+					on_property(e.xproperty);
+					break;
+				case MappingNotify:
+					on_mapping(e.xmapping);
+					break;
+				case EnterNotify:
+					on_enter(e.xcrossing);
+					break;
+				case ClientMessage:
+					on_client_message(e.xclient);
+					break;
+				default:
+					if (m_sync && e.type == m_sync->event_type()) {
+						on_sync_alarm(reinterpret_cast<const x11::events::sync_alarm_notify&>(e));
+						break;
+					}
+					logging::debug<log_subsystem::events>("unknown event {}; ignored", e.type);
+			}
+			return false;
+		}
+
+		// applies one IPC batch, `line` is what the client sent and goes into the recording
+		auto handle_batch(const std::vector<ipc::command>& batch, const std::string& line) -> std::string {
+			if (m_recorder) {
+				m_recorder->write_batch(line);
+			}
+			return apply_batch(batch);
+		}
+
+		// gives up on syncs and closes whose deadline passed; poll() also wakes for other reasons
+		void on_timers() {
+			const auto now = m_display.now();
+			const bool sync_due = m_sync && m_sync->deadline() && *m_sync->deadline() <= now;
+			const auto close_due = m_closes.deadline();
+			if (!sync_due && !(close_due && *close_due <= now)) {
+				return;
+			}
+			if (m_recorder) {
+				m_recorder->write_timers(now);
+			}
+			if (m_sync && m_sync->expire(now)) {
+				relayout_if_pending();
+			}
+			if (!m_closes.empty()) {
+				expire_closes(now);
+			}
+		}
+
+		[[nodiscard]] auto display() -> Display& { return m_display; }
+
+	private:
+		btwm::layout_container root_layout;
+		btwm::rect screen_rect;
+		btwm::rect content_rect;
+		x11::window m_focused{};
+		int m_batch_depth = 0;
+		bool m_relayout_pending = false;
+		// request_count() at the last flush, for the size of each batch
+		unsigned long m_flushed_requests = 0;
+		std::string m_focused_title;
+		bool m_status_dirty = false;
+		x11::pixel m_focused_pixel = 0;
+		x11::pixel m_unfocused_pixel = 0;
+
+		struct held_key {
+			unsigned int keycode;
+			unsigned int state;
+			x11::time_base last;
+		};
+		std::optional<held_key> m_held_key;
+
+		// [first, marker) serials of batches of the window manager's own requests, oldest first
+		std::deque<std::pair<unsigned long, unsigned long>> m_own_serials;
+
+		// every event taken off the queue goes through here; `coalesced` ones are folded into the event being handled
+		auto next_event(bool coalesced) -> x11::events::event {
+			auto e = m_display.next_event();
+			if(m_recorder) {
+				m_recorder->write(e, coalesced);
+			}
+			// events arrive in serial order, nothing older than a batch's marker can follow
+			while(!m_own_serials.empty() && m_own_serials.front().second <= e.xany.serial) {
+				m_own_serials.pop_front();
+			}
+			return e;
+		}
+
+		// relayouts inside a transaction are deferred to its end
+		struct transaction {
+			basic_window_manager& wm;
+			explicit transaction(basic_window_manager& a_wm): wm(a_wm) { ++wm.m_batch_depth; }
+			~transaction() {
+				if(--wm.m_batch_depth == 0) {
+					wm.relayout_if_pending();
+				}
+			}
+			transaction(const transaction&) = delete;
+			transaction& operator=(const transaction&) = delete;
+		};
+
+		// the next relayout also waits until the clients painted the previous one
+		void relayout() {
+			if(m_batch_depth > 0 || (m_sync && m_sync->busy())) {
+				m_relayout_pending = true;
+				return;
+			}
+			tracing::span span("relayout", "requests");
+			const auto requests_before = m_display.request_count();
+			auto target = synced_display<Display>{ m_display, m_sync ? &*m_sync : nullptr, atoms };
+			own_requests([&] { root_layout.resize(target, content_rect); });
+			span.set_arg(static_cast<std::int64_t>(m_display.request_count() - requests_before));
+			publish(ipc::event_kind::layout, [&] {
+					return std::string("layout ") + (std::holds_alternative<btwm::layout_vsplit>(root_layout.type) ? "vsplit" : "hsplit");
+				});
+		}
+
+		void relayout_if_pending() {
+			if (m_relayout_pending) {
+				m_relayout_pending = false;
+				relayout();
+			}
+		}
+
+		// milliseconds until the earliest deadline for poll(), -1 if there is none
+		[[nodiscard]] auto next_timeout() const -> int {
+			std::optional<frame_sync::clock::time_point> deadline;
+			if (m_sync) {
+				deadline = m_sync->deadline();
+			}
+			if (auto close = m_closes.deadline(); close && (!deadline || *close < *deadline)) {
+				deadline = close;
+			}
+			if (!deadline) {
+				return -1;
+			}
+			auto left = std::chrono::ceil<std::chrono::milliseconds>(*deadline - m_display.now());
+			return static_cast<int>(std::max<std::chrono::milliseconds::rep>(0, left.count()));
+		}
+
+		void on_sync_alarm(const x11::events::sync_alarm_notify& e) {
+			if (m_sync->on_alarm(e)) {
+				relayout_if_pending();
+			}
+		}
+
+		/*
+		 * Windows moving under a resting pointer make the server send EnterNotify.
+		 * An event carries the serial of the last request the server processed, so
+		 * crossings caused by the requests `f` sends have one of their serials. A NoOp
+		 * after the batch marks its end: real crossings carry the marker or a later
+		 * serial, even if the window manager sends nothing for a while.
+		 */
+		template <typename F>
+		void own_requests(F&& f) {
+			if constexpr (!config::focus_follows_mouse) {
+				f();
+				return;
+			}
+			const auto first = m_display.request_count() + 1;
+			f();
+			if (m_display.request_count() < first) {
+				return;
+			}
+			m_display.no_op();
+			m_own_serials.emplace_back(first, m_display.request_count());
+		}
+
+		[[nodiscard]] auto is_own_crossing(unsigned long serial) const -> bool {
+			return std::any_of(m_own_serials.begin(), m_own_serials.end(), [&](const auto& batch) {
+					return serial >= batch.first && serial < batch.second;
+				});
+		}
+
+		// everything that is published also ends up in the status page
+		template <typename F>
+		void publish(ipc::event_kind kind, F&& make_line) {
+			m_status_dirty = true;
+			if(m_ipc && m_ipc->has_subscribers(kind)) {
+				m_ipc->broadcast(kind, "event " + make_line());
+			}
+		}
+
+		void update_status() {
+			m_status_dirty = false;
+			status::snapshot s;
+			s.focused = m_focused;
+			s.title = m_focused_title;
+			s.layout = std::holds_alternative<btwm::layout_hsplit>(root_layout.type) ? status::layout_mode::hsplit : status::layout_mode::vsplit;
+			s.windows = m_ewmh->clients();
+			m_status->write(s);
+		}
+
+		void move(direction dir, const x11::window& win) {
+			if (auto node = m_floating.find(win)) {
+				auto r = node->geometry;
+				r.x += dir == direction::left ? -config::floating_step : dir == direction::right ? config::floating_step : 0;
+				r.y += dir == direction::up ? -config::floating_step : dir == direction::down ? config::floating_step : 0;
+				m_floating.place(m_display, win, r);
+				return;
+			}
+			visit_direction(dir, [&](auto d) {
+					// windows are only moved spatially, next/prev have no meaning for moves
+					if constexpr (d != direction::next && d != direction::prev) {
+						root_layout.template move_window<decltype(d)::value>(win);
+					}
+				});
+			relayout();
+		}
+
+		void resize(direction dir, const x11::window& win) {
+			if (auto node = m_floating.find(win)) {
+				auto r = node->geometry;
+				r.w = std::max(config::floating_step, r.w + (dir == direction::left ? -config::floating_step : dir == direction::right ? config::floating_step : 0));
+				r.h = std::max(config::floating_step, r.h + (dir == direction::up ? -config::floating_step : dir == direction::down ? config::floating_step : 0));
+				m_floating.place(m_display, win, r);
+				return;
+			}
+			bool resized = false;
+			visit_direction(dir, [&](auto d) {
+					if constexpr (d != direction::next && d != direction::prev) {
+						resized = root_layout.template resize_window<decltype(d)::value>(win, config::resize_step);
+					}
+				});
+			if (resized) {
+				relayout();
+			}
+		}
+
+		// what the layouts focus through, remembers the window they picked
+		struct focus_target {
+			Display& display;
+			x11::window picked{};
+
+			void set_input_focus(const x11::window& w, x11::revert_to rev, x11::time t) {
+				display.set_input_focus(w, rev, t);
+				picked = w;
+			}
+		};
+
+		// the window that gets the focus, `win` if there is none in that direction
+		auto focus(direction dir, const x11::window& win) -> x11::window {
+			focus_target target{ m_display };
+			visit_direction(dir, [&](auto d) { root_layout.template focus_window<decltype(d)::value>(target, win); });
+			return target.picked == x11::window{} ? win : target.picked;
+		}
+
+		void split(ipc::split_type type) {
+			switch(type) {
+				case ipc::split_type::horizontal:
+					root_layout.type = btwm::layout_hsplit{};
+					break;
+				case ipc::split_type::vertical:
+					root_layout.type = btwm::layout_vsplit{};
+					break;
+				case ipc::split_type::toggle:
+					if(std::holds_alternative<btwm::layout_vsplit>(root_layout.type)){
+						root_layout.type = btwm::layout_hsplit{};
+					} else {
+						root_layout.type = btwm::layout_vsplit{};
+					}
+					break;
+			}
+			relayout();
+		}
+
+		auto apply_batch(const std::vector<ipc::command>& batch) -> std::string {
+			tracing::span span("apply_batch", "commands");
+			span.set_arg(static_cast<std::int64_t>(batch.size()));
+			// checked up front, a batch that fails changes nothing
+			const bool needs_window = std::any_of(batch.begin(), batch.end(), [](const ipc::command& cmd) {
+					return cmd.type == ipc::command_type::focus || cmd.type == ipc::command_type::move || cmd.type == ipc::command_type::kill;
+				});
+			if(needs_window && m_focused == x11::window{}) {
+				throw std::runtime_error("no focused window");
+			}
+			transaction t(*this);
+			// FocusIn only arrives after the batch, later commands act on the window earlier ones focused
+			auto target = m_focused;
+			for(auto & cmd : batch) {
+				switch(cmd.type) {
+					case ipc::command_type::focus:
+						target = focus(cmd.dir, target);
+						break;
+					case ipc::command_type::move:
+						move(cmd.dir, target);
+						break;
+					case ipc::command_type::split:
+						split(cmd.split);
+						break;
+					case ipc::command_type::kill:
+						kill_window(target);
+						relayout();
+						break;
+					case ipc::command_type::spawn: {
+							auto args = cmd.args;
+							m_display.launch_app(args.front(), btwm::array_view<std::string>(args.data() + 1, args.size() - 1));
+						} break;
+					case ipc::command_type::subscribe:
+						break;
+					case ipc::command_type::trace:
+						if(cmd.args.front() == "start") {
+							tracing::recorder::instance().start();
+						} else {
+							auto count = tracing::recorder::instance().stop(cmd.args[1]);
+							logging::info<log_subsystem::events>("wrote {} trace spans", count);
+						}
+						break;
+				}
+			}
+			return "ok";
+		}
+
+		// asks the client to close, never waits for it; see pending_close.hpp for the escalation
+		void kill_window(const x11::window& w) {
+			if( m_display.is_protocoll_supported(w, atoms.wm_delete_window) ) {
+				if (!m_closes.add(w, m_display.now())) {
+					return;
+				}
+				send_protocol(w, atoms.wm_delete_window, CurrentTime);
+			}
+			else {
+				m_display.kill_client(w);
+			}
+		}
+
+		void send_protocol(const x11::window& w, const x11::atom& protocol, x11::time_base time) {
+			x11::events::event event{};
+			auto& msg = event.xclient;
+			msg.type = ClientMessage;
+			msg.message_type = static_cast<x11::atom_base>(atoms.wm_protocols);
+			msg.window = static_cast<x11::window_base>(w);
+			msg.format = 32;
+			msg.data.l[0] = static_cast<long>(protocol);
+			msg.data.l[1] = static_cast<long>(time);
+			msg.data.l[2] = static_cast<long>(w);
+			if(!m_display.send_event(w, false, x11::event_mask::none, event)) {
+				throw std::runtime_error("error sending protocol message");
+			}
+		}
+
+		void expire_closes(pending_closes::clock::time_point now) {
+			for (auto & [w, stage] : m_closes.expired(now)) {
+				if (stage == pending_closes::stage::deleting && m_display.is_protocoll_supported(w, atoms.net_wm_ping)) {
+					logging::debug<log_subsystem::events>("window {} did not close, pinging it", w);
+					send_protocol(w, atoms.net_wm_ping, CurrentTime);
+					m_closes.ping_sent(w, now);
+				}
+				else {
+					logging::info<log_subsystem::events>("window {} does not respond, killing its client", w);
+					m_display.kill_client(w);
+					m_closes.remove(w);
+				}
+			}
+		}
+
+		/*
+		 * With detectable autorepeat a held key sends KeyPress after KeyPress and a single
+		 * KeyRelease at the end. Repeats already queued behind `e` are swallowed, the
+		 * binding runs once for all of them; after that it fires at most once per
+		 * config::key_repeat_interval (in server time) until the key is released.
+		 */
+		bool is_dropped_repeat(const x11::events::key_pressed& e) {
+			while (m_display.queued() > 0) {
+				auto next = m_display.peek_event();
+				if (next.type != KeyPress || next.xkey.keycode != e.keycode || next.xkey.state != e.state) {
+					break;
+				}
+				static_cast<void>(next_event(true));
+			}
+
+			const auto interval = static_cast<x11::time_base>(config::key_repeat_interval.count());
+			if (m_held_key && m_held_key->keycode == e.keycode && m_held_key->state == e.state &&
+					e.time - m_held_key->last < interval) {
+				return true;
+			}
+			m_held_key = held_key{ e.keycode, e.state, e.time };
+			return false;
+		}
+
+		void on_key_release(const x11::events::key_released& e) {
+			if (m_held_key && m_held_key->keycode == e.keycode) {
+				m_held_key.reset();
+			}
+		}
+
+		bool on_key_press(const x11::events::key_pressed& e) {
+			tracing::span span("on_key_press");
+			const auto code = static_cast<x11::key_code_base>(e.keycode);
+			// pressing or re-pressing a modifier is part of typing the chord, not its second key
+			if (m_keys.oneshot() && m_keys.is_modifier(code)) {
+				return false;
+			}
+			auto t = m_keys.lookup(code, e.state);
+			if (!t) {
+				logging::debug<log_subsystem::keys>("unbound key {} pressed with state {}", e.keycode, e.state);
+				if (m_keys.oneshot()) {
+					enter_mode(bindings::key_machine::default_mode, e.time);
+				}
+				return false;
+			}
+			// chords go back to the default mode after their second key
+			const bool leave = m_keys.oneshot() && t->command.action != key_action::mode;
+			// with PointerRoot focus nothing has a FocusIn yet, the key went to the window under the pointer
+			auto win = m_focused;
+			if (win == x11::window{} && is_managed(static_cast<x11::window>(e.subwindow))) {
+				win = static_cast<x11::window>(e.subwindow);
+			}
+			const bool quit = run_command(t->command, t->target, e.time, e.state, win);
+			if (leave) {
+				enter_mode(bindings::key_machine::default_mode, e.time);
+			}
+			return quit;
+		}
+
+		// true if the window manager should quit
+		bool run_command(const key_command& c, std::size_t target, x11::time_base time, unsigned int state, const x11::window& win) {
+			switch (c.action) {
+				case key_action::focus:
+					focus(c.dir, win);
+					break;
+				case key_action::move:
+					move(c.dir, win);
+					break;
+				case key_action::resize:
+					resize(c.dir, win);
+					break;
+				case key_action::split:
+					split(c.split);
+					break;
+				case key_action::kill:
+					if (win != x11::window{}) {
+						logging::debug<log_subsystem::keys>("kill window {}", win);
+						kill_window(win);
+						relayout();
+					}
+					break;
+				case key_action::spawn: {
+						logging::debug<log_subsystem::keys>("launch program");
+						auto no_args = std::array<std::string, 0>{};
+						m_display.launch_app(c.arg, no_args);
+					} break;
+				case key_action::mode:
+					enter_mode(target, time, state);
+					break;
+				case key_action::quit:
+					return true;
+			}
+			return false;
+		}
+
+		void on_mapping(const x11::events::mapping& e) {
+			if (e.request == MappingPointer) {
+				return;
+			}
+			auto mapping = e;
+			m_display.refresh_keyboard_mapping(mapping);
+			if (e.request == MappingKeyboard) {
+				m_keys.remap(m_display, m_root);
+				logging::info<log_subsystem::keys>("keyboard mapping changed, bindings updated");
+			}
+		}
+
+		// only the transitions between the default mode and the others touch the keyboard grab
+		void enter_mode(std::size_t mode, x11::time_base time, unsigned int state = 0) {
+			const auto previous = m_keys.mode();
+			if (mode == previous) {
+				return;
+			}
+			if (previous == bindings::key_machine::default_mode) {
+				if (!m_display.grab_keyboard(m_root, static_cast<x11::time>(time))) {
+					logging::warning<log_subsystem::keys>("could not grab the keyboard for mode {}", mode);
+					return;
+				}
+			}
+			else if (mode == bindings::key_machine::default_mode) {
+				m_display.ungrab_keyboard(static_cast<x11::time>(time));
+			}
+			m_keys.set_mode(mode, state);
+			logging::debug<log_subsystem::keys>("entered mode {}", mode);
+		}
+
+		// the screen without the space docks reserved and the outer gaps
+		auto get_content_rect() const -> btwm::rect {
+			auto r = m_struts.apply(screen_rect);
+			return {
+				r.x + config::outer_gaps,
+				r.y + config::outer_gaps,
+				r.w - 2*config::outer_gaps,
+				r.h - 2*config::outer_gaps
+			};
+		}
+
+		// only called when the reserved area changed, windows that keep their tile are not touched
+		void update_content_rect() {
+			content_rect = get_content_rect();
+			logging::debug<log_subsystem::layout>("docks reserve {} {} {} {}", m_struts.reserved().left,
+					m_struts.reserved().right, m_struts.reserved().top, m_struts.reserved().bottom);
+			relayout();
+		}
+
+		auto get_screen_rect() const -> btwm::rect{
+			btwm::rect r;
+			r.x = 0;
+			r.y = 0;
+			auto screen = m_display.default_screen();
+			r.w = m_display.display_width(screen);
+			r.h = m_display.display_height(screen);
+			return r;
+		}
+
+		void detect_other_wm() {
+			m_display.set_error_handler([](x11::display_base*, x11::events::error*) -> int {throw std::runtime_error("other wm running"); });
+		}
+
+
+		void on_configure_request(const x11::events::configure_request& e) {
+			tracing::span span("on_configure_request");
+			auto leave = root_layout.find_leave(static_cast<x11::window>(e.window));
+			// tiled windows keep their tile, tell them where they are instead; a tile that was
+			// not laid out yet (relayout held back by a sync or a transaction) has nothing to tell
+			if (leave && leave->geometry.w > 0 && leave->geometry.h > 0) {
+				x11::events::event event{};
+				auto& notify = event.xconfigure;
+				notify.type = ConfigureNotify;
+				notify.event = e.window;
+				notify.window = e.window;
+				const auto r = leave->client_rect();
+				notify.x = r.x;
+				notify.y = r.y;
+				notify.width = r.w;
+				notify.height = r.h;
+				notify.border_width = config::border_width;
+				notify.above = None;
+				notify.override_redirect = false;
+				m_display.send_event(static_cast<x11::window>(e.window), false, x11::event_mask::structure_notify, event);
+				return;
+			}
+			auto value_mask = static_cast<unsigned int>(e.value_mask);
+			if (leave) {
+				// passed through until the pending relayout puts it into its tile
+				value_mask &= ~static_cast<unsigned int>(CWBorderWidth);
+			}
+			else if (auto node = m_floating.find(static_cast<x11::window>(e.window))) {
+				// the border belongs to the window manager
+				value_mask &= ~static_cast<unsigned int>(CWBorderWidth);
+				if (e.value_mask & CWX)      { node->geometry.x = e.x; }
+				if (e.value_mask & CWY)      { node->geometry.y = e.y; }
+				if (e.value_mask & CWWidth)  { node->geometry.w = e.width; }
+				if (e.value_mask & CWHeight) { node->geometry.h = e.height; }
+			}
+			x11::window_changes changes;
+			changes.x = e.x;
+			changes.y = e.y;
+			changes.width = e.width;
+			changes.height = e.height;
+			changes.border_width = e.border_width;
+			changes.sibling = e.above;
+			changes.stack_mode = e.detail;
+			m_display.configure_window(static_cast<x11::window>(e.window), value_mask, changes);
+		}
+
+		void on_map_request(const x11::events::map_request& e) {
+			tracing::span span("on_map_request");
+			auto win = static_cast<x11::window>(e.window);
+			// read first, it decides what else is worth asking for; a dock needs nothing more
+			auto types = m_display.get_property(win, atoms.net_wm_window_type, x11::atom_types::atom);
+			if (has_type(types, atoms.net_wm_window_type_dock)) {
+				map_dock(win);
+				return;
+			}
+
+			// property changes for the titles in the status page and the cached _NET_WM_STATE
+			auto mask = x11::event_mask::focus_change | x11::event_mask::property_change;
+			if (config::focus_follows_mouse) {
+				mask = mask | x11::event_mask::enter_window;
+			}
+			m_display.select_input(win, mask);
+
+			const auto properties = fetch_properties(win, std::move(types));
+			const auto rule = m_rules.match(properties);
+			// an explicit rule or a window type saves asking for the hints
+			std::optional<x11::window> transient_for;
+			bool transient_read = false;
+			bool floating;
+			if (rule && rule->floating != rule_floating::automatic) {
+				floating = rule->floating == rule_floating::floating;
+			}
+			else if (is_floating_type(properties.window_type)) {
+				floating = true;
+			}
+			else {
+				// EWMH: only an untyped transient is a dialog, a typed one said what it is
+				if (properties.window_type.empty()) {
+					transient_for = m_display.get_transient_for(win);
+					transient_read = true;
+				}
+				if (transient_for) {
+					floating = true;
+				}
+				else {
+					auto hints = m_display.get_normal_hints(win);
+					floating = hints && is_fixed_size(*hints);
+				}
+			}
+			if (floating) {
+				// never touches the tiling tree
+				if (!transient_read) {
+					transient_for = m_display.get_transient_for(win);
+				}
+				auto r = floating_rect(win, transient_for);
+				decorate(win);
+				own_requests([&] {
+						m_floating.add(m_display, win, r);
+						m_display.map_window(win);
+					});
+				m_display.set_input_focus(win, x11::revert_to::pointer_root, x11::time::current_time);
+				m_ewmh->add_client(m_display, win);
+				publish(ipc::event_kind::window, [&] { return "window new " + ipc::format_window(win); });
+				return;
+			}
+
+			if (m_sync && m_display.is_protocoll_supported(win, atoms.net_wm_sync_request)) {
+				auto counter = m_display.get_property(win, atoms.net_wm_sync_request_counter, x11::atom_types::cardinal);
+				if (!counter.empty()) {
+					m_sync->add(m_display, win, static_cast<x11::sync_counter>(counter.front()));
+				}
+			}
+			decorate(win);
+			own_requests([&] {
+					m_display.map_window(win);
+					m_floating.stack_below(m_display, win);
+				});
+			place_tiled(win, rule);
+			m_window_classes.emplace(win, properties.class_hint.name);
+			m_ewmh->add_client(m_display, win);
+			relayout();
+			// a new window takes the keyboard, bindings act on it right away
+			m_display.set_input_focus(win, x11::revert_to::pointer_root, x11::time::current_time);
+			publish(ipc::event_kind::window, [&] { return "window new " + ipc::format_window(win); });
+		}
+
+		[[nodiscard]] auto is_managed(const x11::window& win) -> bool {
+			return root_layout.has_win(win) || m_floating.contains(win);
+		}
+
+		void decorate(const x11::window& win) {
+			m_display.set_border_width(win, config::border_width);
+			m_display.set_window_border(win, m_unfocused_pixel);
+		}
+
+		static auto has_type(const std::vector<long>& types, const x11::atom& type) -> bool {
+			return std::find(types.begin(), types.end(), static_cast<long>(type)) != types.end();
+		}
+
+		auto is_floating_type(const std::vector<long>& types) const -> bool {
+			return has_type(types, atoms.net_wm_window_type_dialog) || has_type(types, atoms.net_wm_window_type_utility)
+				|| has_type(types, atoms.net_wm_window_type_splash);
+		}
+
+		auto read_strut(const x11::window& win) -> btwm::strut {
+			auto values = m_display.get_property(win, atoms.net_wm_strut_partial, x11::atom_types::cardinal);
+			if (values.empty()) {
+				values = m_display.get_property(win, atoms.net_wm_strut, x11::atom_types::cardinal);
+			}
+			return parse_strut(values);
+		}
+
+		// docks are neither tiled nor focused, they only reserve space
+		void map_dock(const x11::window& win) {
+			m_display.select_input(win, x11::event_mask::property_change);
+			m_display.map_window(win);
+			m_ewmh->add_client(m_display, win);
+			if (m_struts.set(win, read_strut(win))) {
+				update_content_rect();
+			}
+		}
+
+		void on_property(const x11::events::property& e) {
+			auto win = static_cast<x11::window>(e.window);
+			auto property = static_cast<x11::atom>(e.atom);
+			if (property == atoms.net_wm_state) {
+				m_ewmh->on_state_changed(win);
+				return;
+			}
+			if (win == m_focused && m_status && (property == atoms.net_wm_name || property == x11::predefined_atoms::wm_name)) {
+				m_focused_title = get_title(win);
+				m_status_dirty = true;
+				return;
+			}
+			if (!m_struts.contains(win) || (property != atoms.net_wm_strut_partial && property != atoms.net_wm_strut)) {
+				return;
+			}
+			if (m_struts.set(win, read_strut(win))) {
+				update_content_rect();
+			}
+		}
+
+		auto get_title(const x11::window& win) -> std::string {
+			auto title = m_display.get_text_property(win, atoms.net_wm_name, atoms.utf8_string);
+			if (title.empty()) {
+				title = m_display.get_text_property(win, x11::predefined_atoms::wm_name, x11::atom_types::any);
+			}
+			return title;
+		}
+
+		// one read per property the rules can match on, title and role only if a rule uses them
+		auto fetch_properties(const x11::window& win, std::vector<long> types) -> rules::window_properties {
+			rules::window_properties p;
+			p.window_type = std::move(types);
+			p.class_hint = m_display.get_class_hint(win);
+			if (m_rules.needs_title()) {
+				p.title = get_title(win);
+			}
+			if (m_rules.needs_role()) {
+				p.role = m_display.get_text_property(win, atoms.wm_window_role, x11::atom_types::string);
+			}
+			return p;
+		}
+
+		// appends to the root container unless a rule names a window to go beside
+		void place_tiled(const x11::window& win, const btwm::rule* rule) {
+			x11::window anchor{};
+			std::optional<btwm::layout_type> split;
+			if (rule) {
+				if (rule->split == rule_split::horizontal) {
+					split = btwm::layout_hsplit{};
+				}
+				else if (rule->split == rule_split::vertical) {
+					split = btwm::layout_vsplit{};
+				}
+				if (rule->target) {
+					auto it = std::find_if(m_window_classes.begin(), m_window_classes.end(),
+							[&](const auto& c) { return c.second == rule->target; });
+					if (it != m_window_classes.end()) {
+						anchor = it->first;
+					}
+				}
+				else if (split) {
+					anchor = m_focused;
+				}
+			}
+			if (anchor == x11::window{} || !root_layout.insert_beside(anchor, win, split)) {
+				root_layout.add(btwm::layout_leave{win});
+			}
+		}
+
+		// requested size, centered over the window it belongs to or the screen
+		auto floating_rect(const x11::window& win, const std::optional<x11::window>& transient_for) -> btwm::rect {
+			auto r = m_display.get_geometry(win).value_or(btwm::rect{ 0, 0, content_rect.w / 2, content_rect.h / 2 });
+			auto parent = content_rect;
+			if (transient_for) {
+				if (auto leave = root_layout.find_leave(*transient_for)) {
+					parent = leave->geometry;
+				}
+				else if (auto node = m_floating.find(*transient_for)) {
+					parent = node->geometry;
+				}
+			}
+			r.w = std::min(r.w, content_rect.w);
+			r.h = std::min(r.h, content_rect.h);
+			r.x = parent.x + (parent.w - r.w) / 2;
+			r.y = parent.y + (parent.h - r.h) / 2;
+			return r;
+		}
+
+		void on_unmap(const x11::events::unmap& e) {
+			tracing::span span("on_unmap");
+			auto win = static_cast<x11::window>(e.window);
+			m_closes.remove(win);
+			if (m_struts.contains(win)) {
+				m_ewmh->remove_client(m_display, win);
+				if (m_struts.remove(win)) {
+					update_content_rect();
+				}
+				return;
+			}
+			const bool floating = m_floating.contains(win);
+			if (!floating && !root_layout.has_win(win)) {
+				return;
+			}
+			const bool was_focused = win == m_focused;
+			if (was_focused) {
+				m_focused = x11::window{};
+				m_focused_title.clear();
+			}
+			m_ewmh->remove_client(m_display, win);
+			if (m_sync) {
+				m_sync->remove(m_display, win);
+			}
+			publish(ipc::event_kind::window, [&] { return "window close " + ipc::format_window(win); });
+			if (floating) {
+				m_floating.remove(win);
+				if (was_focused && !root_layout.sub_nodes.empty()) {
+					root_layout.focus_any(m_display);
+				}
+				return;
+			}
+			m_window_classes.erase(win);
+			if ( !root_layout.remove_window(win) ) {
+				relayout();
+				root_layout.focus_any(m_display);
+			}
+		}
+
+		// focus changes caused by key grabs or the pointer are not real focus changes
+		[[nodiscard]] static auto is_real_focus_change(const x11::events::focus_change& e) -> bool {
+			return e.mode != NotifyGrab && e.mode != NotifyUngrab && e.detail != NotifyPointer;
+		}
+
+		void on_focus_in(const x11::events::focus_change& e) {
+			if (!is_real_focus_change(e)) {
+				return;
+			}
+			auto win = static_cast<x11::window>(e.window);
+			if (win == m_focused) {
+				return;
+			}
+			// the old and the new window, nothing else
+			if (m_focused != x11::window{}) {
+				m_display.set_window_border(m_focused, m_unfocused_pixel);
+			}
+			m_display.set_window_border(win, m_focused_pixel);
+			m_focused = win;
+			if (m_status) {
+				m_focused_title = get_title(win);
+			}
+			own_requests([&] { m_floating.raise(m_display, win); });
+			m_ewmh->set_active(m_display, win);
+			publish(ipc::event_kind::focus, [&] { return "focus " + ipc::format_window(win); });
+		}
+
+		// focus that went to the root or to a window btwm does not manage, no FocusIn follows
+		void on_focus_out(const x11::events::focus_change& e) {
+			if (!is_real_focus_change(e) || e.detail == NotifyInferior) {
+				return;
+			}
+			auto win = static_cast<x11::window>(e.window);
+			if (win != m_focused) {
+				return;
+			}
+			// the FocusIn of another client is usually right behind, it repaints both borders
+			if (m_display.queued() > 0) {
+				const auto next = m_display.peek_event();
+				if (next.type == FocusIn && is_real_focus_change(next.xfocus)) {
+					on_focus_in(next_event(true).xfocus);
+					return;
+				}
+			}
+			m_display.set_window_border(win, m_unfocused_pixel);
+			m_focused = x11::window{};
+			m_focused_title.clear();
+			m_ewmh->set_active(m_display, x11::window{});
+			publish(ipc::event_kind::focus, [&] { return "focus " + ipc::format_window(x11::window{}); });
+		}
+
+		void on_enter(const x11::events::crossing& first) {
+			// a sweep across several windows queues one crossing each, only the last one counts
+			auto e = first;
+			while (m_display.queued() > 0 && m_display.peek_event().type == EnterNotify) {
+				e = next_event(true).xcrossing;
+			}
+			if (e.mode != NotifyNormal || e.detail == NotifyInferior) {
+				return;
+			}
+			if (is_own_crossing(e.serial)) {
+				return;
+			}
+			auto win = static_cast<x11::window>(e.window);
+			if (win == m_focused || !is_managed(win)) {
+				return;
+			}
+			logging::debug<log_subsystem::events>("pointer focuses {}", win);
+			m_display.set_input_focus(win, x11::revert_to::pointer_root, static_cast<x11::time>(e.time));
+		}
+
+		void on_client_message(const x11::events::client_message& e) {
+			auto win = static_cast<x11::window>(e.window);
+			auto type = static_cast<x11::atom>(e.message_type);
+			// pongs come back to the root window
+			if (win == m_root && type == atoms.wm_protocols && static_cast<x11::atom>(e.data.l[0]) == atoms.net_wm_ping) {
+				if (m_closes.on_pong(static_cast<x11::window>(e.data.l[2]))) {
+					logging::debug<log_subsystem::events>("window {} answered the ping, left open", e.data.l[2]);
+				}
+				return;
+			}
+			if (!is_managed(win)) {
+				return;
+			}
+			if (type == atoms.net_active_window) {
+				m_display.set_input_focus(win, x11::revert_to::pointer_root, x11::time::current_time);
+			}
+			else if (type == atoms.net_close_window) {
+				kill_window(win);
+			}
+		}
+
+		Display m_display;
+		std::optional<recording::event_writer> m_recorder;
+		std::optional<ipc::server> m_ipc;
+		const x11::window m_root;
+		const x11::atoms atoms;
+		bindings::key_machine m_keys;
+		std::optional<ewmh::root_properties> m_ewmh;
+		std::optional<frame_sync> m_sync;
+		floating_layer m_floating;
+		reserved_area m_struts;
+		pending_closes m_closes;
+		std::optional<status::page_writer> m_status;
+		const rules::matcher m_rules{ btwm::array_view<const btwm::rule>(config::rules.data(), config::rules.size()) };
+		// WM_CLASS of the tiled windows, for rule targets
+		std::unordered_map<x11::window, std::string> m_window_classes;
+	};
+}
+
+#endif
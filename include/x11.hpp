@@ -4,6 +4,9 @@
 extern "C" {
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/XKBlib.h>
+#include <X11/extensions/sync.h>
 #include <unistd.h>
 }
 
@@ -11,6 +14,14 @@ extern "C" {
 
 #include <stdexcept>
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace btwm {
 	namespace x11 {
@@ -24,17 +35,41 @@ namespace btwm {
 		enum class key_code: key_code_base {};
 		using screen = ::Screen;
 		using screen_index = int;
-		enum class key_sym: ::KeySym {
-			e = XK_E,
-			h = XK_H,
-			j = XK_J,
-			k = XK_K,
-			l = XK_L,
-			q = XK_Q,
-			Return = XK_Return,
-			space = XK_space
+		using key_sym_base = ::KeySym;
+		enum class key_sym: key_sym_base {};
+
+		namespace atom_types {
+			constexpr auto atom = x11::atom{XA_ATOM};
+			constexpr auto cardinal = x11::atom{XA_CARDINAL};
+			constexpr auto window = x11::atom{XA_WINDOW};
+			constexpr auto string = x11::atom{XA_STRING};
+			constexpr auto any = x11::atom{AnyPropertyType};
+		}
+		namespace predefined_atoms {
+			constexpr auto wm_name = x11::atom{XA_WM_NAME};
+		}
+
+		using prop_mode_base = int;
+		enum class prop_mode: prop_mode_base {
+			replace = PropModeReplace,
+			prepend = PropModePrepend,
+			append = PropModeAppend
+		};
+
+		using sync_counter_base = ::XSyncCounter;
+		enum class sync_counter: sync_counter_base {};
+		using sync_alarm_base = ::XSyncAlarm;
+		enum class sync_alarm: sync_alarm_base {};
+
+		using normal_hints = ::XSizeHints;
+
+		struct class_hint {
+			std::string instance;
+			std::string name;
 		};
 
+		using pixel = unsigned long;
+
 		using time_base = ::Time;
 		enum class time : time_base { current_time };
 
@@ -122,9 +157,44 @@ namespace btwm {
 			using map_request = ::XMapRequestEvent;
 			using unmap = ::XUnmapEvent;
 			using key_pressed = ::XKeyPressedEvent;
+			using key_released = ::XKeyReleasedEvent;
 			using client_message = ::XClientMessageEvent;
+			using focus_change = ::XFocusChangeEvent;
+			using crossing = ::XCrossingEvent;
+			using property = ::XPropertyEvent;
+			using mapping = ::XMappingEvent;
+			using configure = ::XConfigureEvent;
+			using sync_alarm_notify = ::XSyncAlarmNotifyEvent;
 		}
 
+		using error_handler = int(*)(display_base*, events::error*);
+
+		// the queries whose answers a recording keeps, so that replays get the same ones
+		enum class query: std::uint8_t {
+			protocol,
+			property,
+			text_property,
+			transient_for,
+			wm_normal_hints,
+			class_hint,
+			geometry,
+			counter_value
+		};
+
+		/*
+		 * One answer. `property` is the asked for atom (the protocol for query::protocol),
+		 * `window` the counter for query::counter_value; lists and rects go into `values`,
+		 * strings and structs into `text`.
+		 */
+		struct reply {
+			x11::query kind;
+			x11::window window;
+			x11::atom property;
+			std::vector<long> values;
+			std::string text;
+		};
+		using reply_log = std::function<void(const reply&)>;
+
 		struct key_match {
 			x11::key_code key_code;
 			x11::mod_mask include_mask = x11::mod_mask::any;
@@ -161,30 +231,98 @@ namespace btwm {
 			[[nodiscard]] auto make_atom_always(const char* name) -> x11::atom {
 				return static_cast<x11::atom>(XInternAtom(disp, name, false));
 			}
+			template <std::size_t N>
+			[[nodiscard]] auto intern_atoms(const std::array<const char*, N>& names) -> std::array<x11::atom, N> {
+				std::array<char*, N> name_ptrs;
+				std::transform(names.begin(), names.end(), name_ptrs.begin(), [](const char* n) { return const_cast<char*>(n); });
+				std::array<x11::atom_base, N> result;
+				XInternAtoms(disp, name_ptrs.data(), static_cast<int>(N), false, result.data());
+				std::array<x11::atom, N> atoms;
+				std::transform(result.begin(), result.end(), atoms.begin(), [](x11::atom_base a) { return static_cast<x11::atom>(a); });
+				return atoms;
+			}
 			[[nodiscard]] auto keysym_to_keycode(const x11::key_sym& s) -> x11::key_code {
 				return static_cast<x11::key_code>(XKeysymToKeycode(disp, static_cast<::KeySym>(s)));
 			}
+			// every (key code, key sym) pair of the current keyboard mapping, all columns
+			[[nodiscard]] auto keyboard_mapping() -> std::vector<std::pair<x11::key_code, x11::key_sym_base>> {
+				int min_code, max_code, syms_per_code;
+				XDisplayKeycodes(disp, &min_code, &max_code);
+				auto syms = XGetKeyboardMapping(disp, static_cast<x11::key_code_base>(min_code), max_code - min_code + 1, &syms_per_code);
+				std::vector<std::pair<x11::key_code, x11::key_sym_base>> mapping;
+				for(int code = min_code; code <= max_code; ++code) {
+					for(int col = 0; col < syms_per_code; ++col) {
+						auto sym = syms[(code - min_code) * syms_per_code + col];
+						if(sym != NoSymbol) {
+							mapping.emplace_back(static_cast<x11::key_code>(code), sym);
+						}
+					}
+				}
+				XFree(syms);
+				return mapping;
+			}
+			auto set_error_handler(x11::error_handler handler) -> void {
+				XSetErrorHandler(handler);
+			}
 			auto select_input(const x11::window &w, const x11::event_mask& m) -> void {
 				XSelectInput(disp, static_cast<x11::window_base>(w), static_cast<event_mask_base>(m));
 			}
 			auto sync(bool discard) -> void {
 				XSync(disp, discard);
 			}
+			// requests sent on this connection so far
+			[[nodiscard]] auto request_count() const -> unsigned long {
+				return NextRequest(disp) - 1;
+			}
+			[[nodiscard]] auto connection_fd() const -> int {
+				return ConnectionNumber(disp);
+			}
+			// what deadlines are measured with, a replay substitutes the recorded time
+			[[nodiscard]] auto now() const -> std::chrono::steady_clock::time_point {
+				return std::chrono::steady_clock::now();
+			}
+			// flushes the output buffer and returns the number of queued events
+			[[nodiscard]] auto pending() -> int {
+				return XPending(disp);
+			}
+			auto flush() -> void {
+				XFlush(disp);
+			}
 			[[nodiscard]] auto next_event() -> x11::events::event {
 				x11::events::event e;
 				XNextEvent(disp, &e);
 				return e;
 			}
-			[[nodiscard]] auto is_protocoll_supported(const x11::window& w, const x11::atom& atm) {
+			// events already read from the connection, never blocks or flushes
+			[[nodiscard]] auto queued() -> int {
+				return XEventsQueued(disp, QueuedAlready);
+			}
+			// only valid if queued() > 0
+			[[nodiscard]] auto peek_event() -> x11::events::event {
+				x11::events::event e;
+				XPeekEvent(disp, &e);
+				return e;
+			}
+			// held keys repeat as KeyPress only, without a KeyRelease in between
+			auto set_detectable_autorepeat() -> bool {
+				Bool supported = False;
+				return XkbSetDetectableAutoRepeat(disp, True, &supported) && supported;
+			}
+			// every query answer also goes to `log`, until it is reset
+			void log_replies(x11::reply_log log) {
+				m_reply_log = std::move(log);
+			}
+			[[nodiscard]] auto is_protocoll_supported(const x11::window& w, const x11::atom& atm) -> bool {
 				Atom * supported_procs;
 				int cnt;
-				if( !XGetWMProtocols(disp, static_cast<x11::window_base>(w), &supported_procs, &cnt) ) {
-					return false;
+				bool supported = false;
+				if( XGetWMProtocols(disp, static_cast<x11::window_base>(w), &supported_procs, &cnt) ) {
+					auto end_it = supported_procs + cnt;
+					supported = std::find(supported_procs, end_it, static_cast<x11::atom_base>(atm)) != end_it;
+					XFree(supported_procs);
 				}
-				auto end_it = supported_procs + cnt;
-				auto search= std::find(supported_procs, end_it, static_cast<x11::atom_base>(atm));
-				XFree(supported_procs);
-				return search != end_it;
+				log_reply(x11::query::protocol, w, atm, { supported ? 1L : 0L });
+				return supported;
 			}
 
 			void kill_client(const x11::window& w) {
@@ -204,6 +342,21 @@ namespace btwm {
 			auto display_height(const x11::screen_index& scr) const {
 				return DisplayHeight(disp, scr);
 			}
+			// "#rrggbb" or a color name, allocated in the default colormap
+			[[nodiscard]] auto alloc_color(const char* spec) -> x11::pixel {
+				auto colormap = DefaultColormap(disp, DefaultScreen(disp));
+				XColor color;
+				if(!XParseColor(disp, colormap, spec, &color) || !XAllocColor(disp, colormap, &color)) {
+					throw std::runtime_error(std::string("could not allocate color ") + spec);
+				}
+				return color.pixel;
+			}
+			auto set_window_border(const x11::window& w, x11::pixel p) {
+				XSetWindowBorder(disp, static_cast<x11::window_base>(w), p);
+			}
+			auto set_border_width(const x11::window& w, unsigned int width) {
+				XSetWindowBorderWidth(disp, static_cast<x11::window_base>(w), width);
+			}
 			auto configure_window(const x11::window & w, unsigned int value_mask, x11::window_changes changes) {
 				XConfigureWindow(disp, static_cast<x11::window_base>(w), value_mask, &changes);
 			}
@@ -220,13 +373,179 @@ namespace btwm {
 					}
 				}
 			}
+			auto ungrab_key(const key_match& k, const x11::window& w) {
+				for(x11::mod_mask_base i = 0; i < (1 << 8); ++i) {
+					if( k.matches_mod_mask(static_cast<x11::mod_mask>(i)) ) {
+						XUngrabKey(disp, static_cast<x11::key_code_base>(k.key_code), i, static_cast<x11::window_base>(w));
+					}
+				}
+			}
+			// drops Xlib's cached keyboard mapping after a MappingNotify
+			auto refresh_keyboard_mapping(x11::events::mapping& e) -> void {
+				XRefreshKeyboardMapping(&e);
+			}
+			// the whole keyboard, false if another client holds a grab
+			auto grab_keyboard(const x11::window& w, x11::time t) -> bool {
+				return XGrabKeyboard(disp, static_cast<x11::window_base>(w), false, GrabModeAsync, GrabModeAsync,
+						static_cast<x11::time_base>(t)) == GrabSuccess;
+			}
+			auto ungrab_keyboard(x11::time t) -> void {
+				XUngrabKeyboard(disp, static_cast<x11::time_base>(t));
+			}
+			auto create_window(const x11::window& parent, const btwm::rect& r) -> x11::window {
+				return static_cast<x11::window>(XCreateSimpleWindow(disp, static_cast<x11::window_base>(parent),
+						r.x, r.y, static_cast<unsigned int>(r.w), static_cast<unsigned int>(r.h), 0, 0, 0));
+			}
+			// format 32 property; X wants longs even for 32 bit values
+			auto change_property(const x11::window& w, const x11::atom& property, const x11::atom& type,
+					x11::prop_mode mode, btwm::array_view<const long> data) {
+				XChangeProperty(disp, static_cast<x11::window_base>(w), static_cast<x11::atom_base>(property),
+						static_cast<x11::atom_base>(type), 32, static_cast<x11::prop_mode_base>(mode),
+						reinterpret_cast<const unsigned char*>(data.data()), static_cast<int>(data.size()));
+			}
+			// format 8 property
+			auto change_property(const x11::window& w, const x11::atom& property, const x11::atom& type,
+					x11::prop_mode mode, const std::string& data) {
+				XChangeProperty(disp, static_cast<x11::window_base>(w), static_cast<x11::atom_base>(property),
+						static_cast<x11::atom_base>(type), 8, static_cast<x11::prop_mode_base>(mode),
+						reinterpret_cast<const unsigned char*>(data.data()), static_cast<int>(data.size()));
+			}
+			// format 32 property of `type`, empty if it is not set
+			[[nodiscard]] auto get_property(const x11::window& w, const x11::atom& property, const x11::atom& type) -> std::vector<long> {
+				x11::atom_base actual_type;
+				int actual_format;
+				unsigned long count, bytes_after;
+				unsigned char* data = nullptr;
+				std::vector<long> result;
+				if(XGetWindowProperty(disp, static_cast<x11::window_base>(w), static_cast<x11::atom_base>(property),
+						0, 1024, false, static_cast<x11::atom_base>(type),
+						&actual_type, &actual_format, &count, &bytes_after, &data) == Success && data) {
+					if(actual_format == 32) {
+						auto values = reinterpret_cast<long*>(data);
+						result.assign(values, values + count);
+					}
+					XFree(data);
+				}
+				log_reply(x11::query::property, w, property, result);
+				return result;
+			}
+			// format 8 property of `type`, empty if it is not set
+			[[nodiscard]] auto get_text_property(const x11::window& w, const x11::atom& property, const x11::atom& type) -> std::string {
+				x11::atom_base actual_type;
+				int actual_format;
+				unsigned long count, bytes_after;
+				unsigned char* data = nullptr;
+				std::string result;
+				if(XGetWindowProperty(disp, static_cast<x11::window_base>(w), static_cast<x11::atom_base>(property),
+						0, 256, false, static_cast<x11::atom_base>(type),
+						&actual_type, &actual_format, &count, &bytes_after, &data) == Success && data) {
+					if(actual_format == 8) {
+						result.assign(reinterpret_cast<const char*>(data), count);
+					}
+					XFree(data);
+				}
+				log_reply(x11::query::text_property, w, property, {}, result);
+				return result;
+			}
+			[[nodiscard]] auto get_transient_for(const x11::window& w) -> std::optional<x11::window> {
+				x11::window_base parent = None;
+				if(XGetTransientForHint(disp, static_cast<x11::window_base>(w), &parent) && parent != None) {
+					log_reply(x11::query::transient_for, w, x11::atom{}, { static_cast<long>(parent) });
+					return static_cast<x11::window>(parent);
+				}
+				log_reply(x11::query::transient_for, w, x11::atom{}, {});
+				return std::nullopt;
+			}
+			[[nodiscard]] auto get_normal_hints(const x11::window& w) -> std::optional<x11::normal_hints> {
+				x11::normal_hints hints;
+				long supplied;
+				if(!XGetWMNormalHints(disp, static_cast<x11::window_base>(w), &hints, &supplied)) {
+					log_reply(x11::query::wm_normal_hints, w, x11::atom{}, {});
+					return std::nullopt;
+				}
+				log_reply(x11::query::wm_normal_hints, w, x11::atom{}, {}, std::string(reinterpret_cast<const char*>(&hints), sizeof(hints)));
+				return hints;
+			}
+			[[nodiscard]] auto get_class_hint(const x11::window& w) -> x11::class_hint {
+				XClassHint hint{ nullptr, nullptr };
+				x11::class_hint result;
+				if(XGetClassHint(disp, static_cast<x11::window_base>(w), &hint)) {
+					if(hint.res_name) {
+						result.instance = hint.res_name;
+						XFree(hint.res_name);
+					}
+					if(hint.res_class) {
+						result.name = hint.res_class;
+						XFree(hint.res_class);
+					}
+				}
+				log_reply(x11::query::class_hint, w, x11::atom{}, {}, result.instance + '\0' + result.name);
+				return result;
+			}
+			[[nodiscard]] auto get_geometry(const x11::window& w) -> std::optional<btwm::rect> {
+				x11::window_base root;
+				int x, y;
+				unsigned int width, height, border, depth;
+				if(!XGetGeometry(disp, static_cast<x11::window_base>(w), &root, &x, &y, &width, &height, &border, &depth)) {
+					log_reply(x11::query::geometry, w, x11::atom{}, {});
+					return std::nullopt;
+				}
+				log_reply(x11::query::geometry, w, x11::atom{}, { x, y, static_cast<long>(width), static_cast<long>(height) });
+				return btwm::rect{ x, y, static_cast<int>(width), static_cast<int>(height) };
+			}
+			// event base of the SYNC extension, nullopt if the server does not have it
+			[[nodiscard]] auto init_sync_extension() -> std::optional<int> {
+				int event_base, error_base, major, minor;
+				if(!XSyncQueryExtension(disp, &event_base, &error_base) || !XSyncInitialize(disp, &major, &minor)) {
+					return std::nullopt;
+				}
+				return event_base;
+			}
+			// current value of `counter`, nullopt if the server does not know it
+			[[nodiscard]] auto query_counter(const x11::sync_counter& counter) -> std::optional<std::int64_t> {
+				const auto id = static_cast<x11::window>(counter);
+				XSyncValue value;
+				if(!XSyncQueryCounter(disp, static_cast<x11::sync_counter_base>(counter), &value)) {
+					log_reply(x11::query::counter_value, id, x11::atom{}, {});
+					return std::nullopt;
+				}
+				const auto result = static_cast<std::int64_t>(
+						(static_cast<std::uint64_t>(static_cast<std::uint32_t>(XSyncValueHigh32(value))) << 32) | XSyncValueLow32(value));
+				log_reply(x11::query::counter_value, id, x11::atom{}, { static_cast<long>(result) });
+				return result;
+			}
+			// alarm that reports once `counter` reaches `value`
+			[[nodiscard]] auto create_alarm(const x11::sync_counter& counter, std::int64_t value) -> x11::sync_alarm {
+				XSyncAlarmAttributes attr;
+				attr.trigger.counter = static_cast<x11::sync_counter_base>(counter);
+				attr.trigger.value_type = XSyncAbsolute;
+				attr.trigger.test_type = XSyncPositiveComparison;
+				XSyncIntsToValue(&attr.trigger.wait_value, static_cast<unsigned int>(value & 0xffffffff), static_cast<int>(value >> 32));
+				XSyncIntToValue(&attr.delta, 0);
+				attr.events = true;
+				return static_cast<x11::sync_alarm>(XSyncCreateAlarm(disp,
+						XSyncCACounter | XSyncCAValueType | XSyncCAValue | XSyncCATestType | XSyncCADelta | XSyncCAEvents,
+						&attr));
+			}
+			auto change_alarm(const x11::sync_alarm& alarm, std::int64_t value) {
+				XSyncAlarmAttributes attr;
+				XSyncIntsToValue(&attr.trigger.wait_value, static_cast<unsigned int>(value & 0xffffffff), static_cast<int>(value >> 32));
+				XSyncChangeAlarm(disp, static_cast<x11::sync_alarm_base>(alarm), XSyncCAValue, &attr);
+			}
+			auto destroy_alarm(const x11::sync_alarm& alarm) {
+				XSyncDestroyAlarm(disp, static_cast<x11::sync_alarm_base>(alarm));
+			}
 			auto map_window(const x11::window& w) {
 				XMapWindow(disp, static_cast<x11::window_base>(w));
 			}
+			// one ConfigureWindow, so the client sees a single ConfigureNotify with the final geometry
 			auto window_to_rect(const x11::window& w, const btwm::rect& r) {
-				auto win = static_cast<x11::window_base>(w);
-				XMoveWindow(disp, win, r.x, r.y);
-				XResizeWindow(disp, win, static_cast<unsigned int>(r.w), static_cast<unsigned int>(r.h));
+				XMoveResizeWindow(disp, static_cast<x11::window_base>(w), r.x, r.y,
+						static_cast<unsigned int>(r.w), static_cast<unsigned int>(r.h));
+			}
+			// does nothing, but its serial tells events after it from events before it
+			auto no_op() {
+				XNoOp(disp);
 			}
 			auto raise_window(const x11::window& w) {
 				XRaiseWindow(disp, static_cast<x11::window_base>(w));
@@ -261,39 +580,103 @@ namespace btwm {
 				}
 			}
 		private:
+			void log_reply(x11::query kind, const x11::window& w, const x11::atom& property,
+					const std::vector<long>& values, const std::string& text = {}) {
+				if(m_reply_log) {
+					m_reply_log({ kind, w, property, values, text });
+				}
+			}
+
 			x11::display_base*const disp;
+			x11::reply_log m_reply_log;
 		};
 
 
+		// interned with a single round trip, `names` and the members are in the same order
 		struct atoms {
+			static constexpr std::array<const char*, 25> names = {
+				"WM_DELETE_WINDOW",
+				"WM_PROTOCOLS",
+				"UTF8_STRING",
+				"_NET_SUPPORTED",
+				"_NET_SUPPORTING_WM_CHECK",
+				"_NET_WM_NAME",
+				"_NET_CLIENT_LIST",
+				"_NET_ACTIVE_WINDOW",
+				"_NET_NUMBER_OF_DESKTOPS",
+				"_NET_CURRENT_DESKTOP",
+				"_NET_WM_DESKTOP",
+				"_NET_CLOSE_WINDOW",
+				"_NET_WM_STATE",
+				"_NET_WM_STATE_FOCUSED",
+				"_NET_WM_SYNC_REQUEST",
+				"_NET_WM_SYNC_REQUEST_COUNTER",
+				"WM_WINDOW_ROLE",
+				"_NET_WM_WINDOW_TYPE",
+				"_NET_WM_WINDOW_TYPE_DOCK",
+				"_NET_WM_STRUT",
+				"_NET_WM_STRUT_PARTIAL",
+				"_NET_WM_PING",
+				"_NET_WM_WINDOW_TYPE_DIALOG",
+				"_NET_WM_WINDOW_TYPE_UTILITY",
+				"_NET_WM_WINDOW_TYPE_SPLASH"
+			};
 			const x11::atom wm_delete_window;
 			const x11::atom wm_protocols;
+			const x11::atom utf8_string;
+			const x11::atom net_supported;
+			const x11::atom net_supporting_wm_check;
+			const x11::atom net_wm_name;
+			const x11::atom net_client_list;
+			const x11::atom net_active_window;
+			const x11::atom net_number_of_desktops;
+			const x11::atom net_current_desktop;
+			const x11::atom net_wm_desktop;
+			const x11::atom net_close_window;
+			const x11::atom net_wm_state;
+			const x11::atom net_wm_state_focused;
+			const x11::atom net_wm_sync_request;
+			const x11::atom net_wm_sync_request_counter;
+			const x11::atom wm_window_role;
+			const x11::atom net_wm_window_type;
+			const x11::atom net_wm_window_type_dock;
+			const x11::atom net_wm_strut;
+			const x11::atom net_wm_strut_partial;
+			const x11::atom net_wm_ping;
+			const x11::atom net_wm_window_type_dialog;
+			const x11::atom net_wm_window_type_utility;
+			const x11::atom net_wm_window_type_splash;
 			atoms() = delete;
-			explicit atoms(x11::display& disp):
-				wm_delete_window(disp.make_atom_always("WM_DELETE_WINDOW")),
-				wm_protocols(disp.make_atom_always("WM_PROTOCOLS"))
-			{ }
-		};
+			template <typename Display>
+			explicit atoms(Display& disp): atoms(disp.intern_atoms(names)) { }
 
-		struct key_codes {
-			const x11::key_code e;
-			const x11::key_code h;
-			const x11::key_code j;
-			const x11::key_code k;
-			const x11::key_code l;
-			const x11::key_code q;
-			const x11::key_code Return;
-			const x11::key_code space;
-			key_codes() = delete;
-			explicit key_codes(x11::display& disp):
-				e(disp.keysym_to_keycode(key_sym::e)),
-				h(disp.keysym_to_keycode(key_sym::h)),
-				j(disp.keysym_to_keycode(key_sym::j)),
-				k(disp.keysym_to_keycode(key_sym::k)),
-				l(disp.keysym_to_keycode(key_sym::l)),
-				q(disp.keysym_to_keycode(key_sym::q)),
-				Return(disp.keysym_to_keycode(key_sym::Return)),
-				space(disp.keysym_to_keycode(key_sym::space))
+		private:
+			explicit atoms(const std::array<x11::atom, names.size()>& a):
+				wm_delete_window(a[0]),
+				wm_protocols(a[1]),
+				utf8_string(a[2]),
+				net_supported(a[3]),
+				net_supporting_wm_check(a[4]),
+				net_wm_name(a[5]),
+				net_client_list(a[6]),
+				net_active_window(a[7]),
+				net_number_of_desktops(a[8]),
+				net_current_desktop(a[9]),
+				net_wm_desktop(a[10]),
+				net_close_window(a[11]),
+				net_wm_state(a[12]),
+				net_wm_state_focused(a[13]),
+				net_wm_sync_request(a[14]),
+				net_wm_sync_request_counter(a[15]),
+				wm_window_role(a[16]),
+				net_wm_window_type(a[17]),
+				net_wm_window_type_dock(a[18]),
+				net_wm_strut(a[19]),
+				net_wm_strut_partial(a[20]),
+				net_wm_ping(a[21]),
+				net_wm_window_type_dialog(a[22]),
+				net_wm_window_type_utility(a[23]),
+				net_wm_window_type_splash(a[24])
 			{ }
 		};
 	}
@@ -0,0 +1,179 @@
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <event_record.hpp>
+#include <recording_display.hpp>
+#include <window_manager.hpp>
+
+
+
+using namespace btwm;
+
+using replay_window_manager = basic_window_manager<x11::recording_display>;
+
+namespace {
+	struct event_stats {
+		std::size_t count = 0;
+		std::chrono::nanoseconds total{};
+		std::chrono::nanoseconds max{};
+	};
+
+	auto event_name(int type) -> const char* {
+		switch(type) {
+			case KeyPress:         return "KeyPress";
+			case KeyRelease:       return "KeyRelease";
+			case ButtonPress:      return "ButtonPress";
+			case EnterNotify:      return "EnterNotify";
+			case FocusIn:          return "FocusIn";
+			case FocusOut:         return "FocusOut";
+			case CreateNotify:     return "CreateNotify";
+			case DestroyNotify:    return "DestroyNotify";
+			case UnmapNotify:      return "UnmapNotify";
+			case MapNotify:        return "MapNotify";
+			case MapRequest:       return "MapRequest";
+			case ReparentNotify:   return "ReparentNotify";
+			case ConfigureNotify:  return "ConfigureNotify";
+			case ConfigureRequest: return "ConfigureRequest";
+			case PropertyNotify:   return "PropertyNotify";
+			case ClientMessage:    return "ClientMessage";
+			case MappingNotify:    return "MappingNotify";
+			default:               return "other";
+		}
+	}
+
+	auto usage(const char* self) -> int {
+		std::cerr << "usage: " << self << " [--repeat N] [--requests FILE] RECORD\n";
+		return 1;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::string record_path;
+	std::string requests_path;
+	int repeat = 1;
+	for(int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if(arg == "--repeat" && i + 1 < argc) {
+			repeat = std::max(1, std::atoi(argv[++i]));
+		}
+		else if(arg == "--requests" && i + 1 < argc) {
+			requests_path = argv[++i];
+		}
+		else if(record_path.empty() && arg.front() != '-') {
+			record_path = arg;
+		}
+		else {
+			return usage(argv[0]);
+		}
+	}
+	if(record_path.empty()) {
+		return usage(argv[0]);
+	}
+
+	std::array<event_stats, LASTEvent> stats{};
+	event_stats batch_stats{};
+	event_stats timer_stats{};
+	std::vector<std::chrono::nanoseconds> latencies;
+	std::array<std::size_t, static_cast<std::size_t>(x11::recording_display::request_kind::count)> request_counts{};
+	std::chrono::nanoseconds recorded_duration{};
+
+	for(int round = 0; round < repeat; ++round) {
+		recording::event_reader reader(record_path);
+		auto wm = replay_window_manager::create(reader.info());
+		auto & display = wm->display();
+		display.clear();
+
+		recording::entry e;
+		while(reader.next(e)) {
+			recorded_duration = e.time;
+			display.set_time(e.time);
+			display.queue_events(reader.coalesced());
+			display.answer_queries(reader.replies());
+			bool quit = false;
+			const auto start = std::chrono::steady_clock::now();
+			switch(e.kind) {
+				case recording::entry_kind::event:
+					quit = wm->handle_event(e.event);
+					break;
+				case recording::entry_kind::batch:
+					// a batch that failed live fails the same way here
+					try {
+						wm->handle_batch(ipc::parse_batch(e.line), e.line);
+					}
+					catch(const std::exception&) { }
+					break;
+				case recording::entry_kind::timers:
+					wm->on_timers();
+					break;
+			}
+			const auto took = std::chrono::steady_clock::now() - start;
+
+			auto & s = e.kind == recording::entry_kind::batch ? batch_stats
+				: e.kind == recording::entry_kind::timers ? timer_stats
+				: stats[static_cast<std::size_t>(e.event.type) % stats.size()];
+			s.count++;
+			s.total += took;
+			s.max = std::max<std::chrono::nanoseconds>(s.max, took);
+			latencies.push_back(took);
+			if(quit) {
+				break;
+			}
+		}
+
+		for(auto & r : display.requests()) {
+			request_counts[static_cast<std::size_t>(r.kind)]++;
+		}
+		if(round == 0 && !requests_path.empty()) {
+			std::ofstream out(requests_path);
+			display.dump(out);
+		}
+	}
+
+	using us = std::chrono::duration<double, std::micro>;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "recorded session: " << std::chrono::duration<double>(recorded_duration).count() << " s, "
+		<< latencies.size() / static_cast<std::size_t>(repeat) << " events, " << repeat << " rounds\n\n";
+
+	std::cout << std::left << std::setw(18) << "event" << std::right
+		<< std::setw(10) << "count" << std::setw(14) << "mean us" << std::setw(14) << "max us" << '\n';
+	auto print_stats = [&](const char* name, const event_stats& s) {
+		if(s.count == 0) { return; }
+		std::cout << std::left << std::setw(18) << name << std::right
+			<< std::setw(10) << s.count
+			<< std::setw(14) << us(s.total).count() / static_cast<double>(s.count)
+			<< std::setw(14) << us(s.max).count() << '\n';
+	};
+	for(std::size_t type = 0; type < stats.size(); ++type) {
+		print_stats(event_name(static_cast<int>(type)), stats[type]);
+	}
+	print_stats("IPC batch", batch_stats);
+	print_stats("timers", timer_stats);
+
+	if(!latencies.empty()) {
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&](double p) {
+			return us(latencies[static_cast<std::size_t>(p * static_cast<double>(latencies.size() - 1))]).count();
+		};
+		std::cout << "\nhandler latency us: p50 " << percentile(0.5)
+			<< ", p90 " << percentile(0.9)
+			<< ", p99 " << percentile(0.99)
+			<< ", max " << percentile(1.0) << '\n';
+	}
+
+	std::cout << "\nrequests per round:\n";
+	for(std::size_t kind = 0; kind < request_counts.size(); ++kind) {
+		if(request_counts[kind] == 0) { continue; }
+		std::cout << "  " << std::left << std::setw(18)
+			<< x11::recording_display::to_string(static_cast<x11::recording_display::request_kind>(kind))
+			<< std::right << std::setw(10) << request_counts[kind] / static_cast<std::size_t>(repeat) << '\n';
+	}
+	return 0;
+}
@@ -0,0 +1,398 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+}
+
+/*
+ * Starts btwm under a private Xvfb and measures what a user would feel:
+ * map latency, key to focus latency and map/unmap storms. Every scenario gets
+ * a fresh btwm so that the X request count it prints on quit belongs to that scenario.
+ */
+
+namespace {
+	using clock = std::chrono::steady_clock;
+	using ms = std::chrono::duration<double, std::milli>;
+
+	struct process {
+		pid_t pid = -1;
+		std::string log_path;
+	};
+
+	auto spawn(const std::vector<std::string>& args, const std::string& display_name, const std::string& log_path) -> process {
+		auto pid = fork();
+		switch(pid) {
+			case -1:
+				throw std::runtime_error("forking failed");
+			case 0: {
+					std::vector<char*> argv;
+					for(auto & a : args) {
+						argv.push_back(const_cast<char*>(a.c_str()));
+					}
+					argv.push_back(nullptr);
+					setenv("DISPLAY", display_name.c_str(), 1);
+					auto fd = open(log_path.empty() ? "/dev/null" : log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+					dup2(fd, STDOUT_FILENO);
+					dup2(fd, STDERR_FILENO);
+					execv(argv[0], argv.data());
+					_exit(127);
+				}
+			default:
+				return { pid, log_path };
+		}
+	}
+
+	// true if the process exited before the timeout
+	auto wait_exit(process& p, std::chrono::milliseconds timeout) -> bool {
+		const auto deadline = clock::now() + timeout;
+		while(clock::now() < deadline) {
+			int status;
+			if(waitpid(p.pid, &status, WNOHANG) == p.pid) {
+				p.pid = -1;
+				return true;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		return false;
+	}
+
+	void stop(process& p) {
+		if(p.pid <= 0) { return; }
+		kill(p.pid, SIGTERM);
+		if(!wait_exit(p, std::chrono::milliseconds(1000))) {
+			kill(p.pid, SIGKILL);
+			waitpid(p.pid, nullptr, 0);
+			p.pid = -1;
+		}
+	}
+
+	struct result {
+		std::string name;
+		std::vector<double> samples_ms;
+		long wm_requests = -1;
+		unsigned long client_requests = 0;
+	};
+
+	class harness {
+	public:
+		harness(std::string btwm, std::string display_name):
+			m_btwm(std::move(btwm)),
+			m_display_name(std::move(display_name)),
+			m_dpy(nullptr)
+		{
+			const auto deadline = clock::now() + std::chrono::seconds(10);
+			while(!(m_dpy = XOpenDisplay(m_display_name.c_str()))) {
+				if(clock::now() > deadline) {
+					throw std::runtime_error("could not connect to Xvfb on " + m_display_name);
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			}
+			int ev, err, major, minor;
+			if(!XTestQueryExtension(m_dpy, &ev, &err, &major, &minor)) {
+				throw std::runtime_error("Xvfb has no XTEST extension");
+			}
+			m_root = DefaultRootWindow(m_dpy);
+			m_super = XKeysymToKeycode(m_dpy, XK_Super_L);
+			m_shift = XKeysymToKeycode(m_dpy, XK_Shift_L);
+		}
+		~harness() {
+			stop(m_wm);
+			XCloseDisplay(m_dpy);
+		}
+		harness(const harness&) = delete;
+		harness& operator=(const harness&) = delete;
+
+		// time from XMapWindow to the last ConfigureNotify of the new window
+		auto map_latency(std::size_t clients) -> result {
+			result r{ "map -> tiled", {}, -1, 0 };
+			start_wm();
+			const auto requests_before = NextRequest(m_dpy);
+			for(std::size_t i = 0; i < clients; ++i) {
+				auto w = make_client();
+				const auto t0 = clock::now();
+				XMapWindow(m_dpy, w);
+				XFlush(m_dpy);
+				auto last = settle(w, std::chrono::milliseconds(50));
+				r.samples_ms.push_back(ms(last - t0).count());
+			}
+			r.client_requests = NextRequest(m_dpy) - requests_before;
+			r.wm_requests = quit_wm();
+			destroy_clients();
+			return r;
+		}
+
+		// time from a Super+h/l KeyPress to the FocusIn on the neighbouring window
+		auto focus_latency(std::size_t clients, std::size_t presses) -> result {
+			result r{ "key -> focus", {}, -1, 0 };
+			start_wm();
+			for(std::size_t i = 0; i < clients; ++i) {
+				XMapWindow(m_dpy, make_client());
+			}
+			XFlush(m_dpy);
+			settle(None, std::chrono::milliseconds(100));
+			XSetInputFocus(m_dpy, m_clients.front(), RevertToPointerRoot, CurrentTime);
+			XSync(m_dpy, false);
+			drain();
+
+			const auto requests_before = NextRequest(m_dpy);
+			std::size_t position = 0;
+			bool right = true;
+			for(std::size_t i = 0; i < presses; ++i) {
+				if(right && position + 1 == clients) { right = false; }
+				if(!right && position == 0) { right = true; }
+				const auto t0 = clock::now();
+				press(XKeysymToKeycode(m_dpy, right ? XK_l : XK_h), false);
+				if(auto t = wait_focus_in(std::chrono::milliseconds(1000))) {
+					r.samples_ms.push_back(ms(*t - t0).count());
+				}
+				position = right ? position + 1 : position - 1;
+			}
+			r.client_requests = NextRequest(m_dpy) - requests_before;
+			r.wm_requests = quit_wm();
+			destroy_clients();
+			return r;
+		}
+
+		// `clients` windows mapped at once and unmapped at once, one sample per storm
+		auto storm(std::size_t clients, std::size_t rounds) -> std::pair<result, result> {
+			result map_r{ "map storm", {}, -1, 0 };
+			result unmap_r{ "unmap storm", {}, -1, 0 };
+			start_wm();
+			for(std::size_t i = 0; i < clients; ++i) {
+				make_client();
+			}
+			XSync(m_dpy, false);
+			const auto requests_before = NextRequest(m_dpy);
+			for(std::size_t round = 0; round < rounds; ++round) {
+				auto t0 = clock::now();
+				for(auto w : m_clients) { XMapWindow(m_dpy, w); }
+				XFlush(m_dpy);
+				map_r.samples_ms.push_back(ms(settle(None, std::chrono::milliseconds(200)) - t0).count());
+
+				t0 = clock::now();
+				for(auto w : m_clients) { XUnmapWindow(m_dpy, w); }
+				XFlush(m_dpy);
+				unmap_r.samples_ms.push_back(ms(settle(None, std::chrono::milliseconds(200)) - t0).count());
+			}
+			map_r.client_requests = NextRequest(m_dpy) - requests_before;
+			map_r.wm_requests = quit_wm();
+			destroy_clients();
+			return { map_r, unmap_r };
+		}
+
+	private:
+		std::string m_btwm;
+		std::string m_display_name;
+		Display* m_dpy;
+		Window m_root = None;
+		KeyCode m_super = 0;
+		KeyCode m_shift = 0;
+		process m_wm;
+		std::vector<Window> m_clients;
+
+		void start_wm() {
+			char log_path[] = "/tmp/btwm_stress_XXXXXX";
+			auto fd = mkstemp(log_path);
+			if(fd < 0) {
+				throw std::runtime_error("could not create log file");
+			}
+			close(fd);
+			m_wm = spawn({ m_btwm }, m_display_name, log_path);
+
+			// btwm is ready as soon as someone selected substructure redirect on the root
+			const auto deadline = clock::now() + std::chrono::seconds(5);
+			for(;;) {
+				XWindowAttributes attr;
+				XGetWindowAttributes(m_dpy, m_root, &attr);
+				if(attr.all_event_masks & SubstructureRedirectMask) {
+					break;
+				}
+				if(clock::now() > deadline) {
+					throw std::runtime_error("btwm did not start");
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+
+		// quits btwm through its key binding and returns the request count it printed to stderr
+		auto quit_wm() -> long {
+			press(XKeysymToKeycode(m_dpy, XK_e), true);
+			if(!wait_exit(m_wm, std::chrono::milliseconds(2000))) {
+				stop(m_wm);
+			}
+			std::ifstream log(m_wm.log_path);
+			std::string line;
+			long requests = -1;
+			while(std::getline(log, line)) {
+				const std::string marker = "quit after ";
+				if(auto pos = line.find(marker); pos != std::string::npos) {
+					requests = std::atol(line.c_str() + pos + marker.size());
+				}
+			}
+			std::remove(m_wm.log_path.c_str());
+			return requests;
+		}
+
+		auto make_client() -> Window {
+			auto w = XCreateSimpleWindow(m_dpy, m_root, 0, 0, 100, 100, 0, 0, 0);
+			XSelectInput(m_dpy, w, StructureNotifyMask | FocusChangeMask);
+			m_clients.push_back(w);
+			return w;
+		}
+
+		void destroy_clients() {
+			for(auto w : m_clients) {
+				XDestroyWindow(m_dpy, w);
+			}
+			m_clients.clear();
+			XSync(m_dpy, false);
+			drain();
+		}
+
+		void press(KeyCode key, bool shift) {
+			XTestFakeKeyEvent(m_dpy, m_super, true, CurrentTime);
+			if(shift) { XTestFakeKeyEvent(m_dpy, m_shift, true, CurrentTime); }
+			XTestFakeKeyEvent(m_dpy, key, true, CurrentTime);
+			XTestFakeKeyEvent(m_dpy, key, false, CurrentTime);
+			if(shift) { XTestFakeKeyEvent(m_dpy, m_shift, false, CurrentTime); }
+			XTestFakeKeyEvent(m_dpy, m_super, false, CurrentTime);
+			XFlush(m_dpy);
+		}
+
+		void drain() {
+			XEvent e;
+			while(XPending(m_dpy)) {
+				XNextEvent(m_dpy, &e);
+			}
+		}
+
+		// blocks until there was no event for `quiet`, returns the arrival of the last
+		// ConfigureNotify (for `w` only, unless it is None)
+		auto settle(Window w, std::chrono::milliseconds quiet) -> clock::time_point {
+			auto last_configure = clock::now();
+			auto last_event = last_configure;
+			pollfd fd{ ConnectionNumber(m_dpy), POLLIN, 0 };
+			for(;;) {
+				while(XPending(m_dpy)) {
+					XEvent e;
+					XNextEvent(m_dpy, &e);
+					last_event = clock::now();
+					if(e.type == ConfigureNotify && (w == None || e.xconfigure.window == w)) {
+						last_configure = last_event;
+					}
+				}
+				auto left = quiet - std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - last_event);
+				if(left.count() <= 0) {
+					return last_configure;
+				}
+				poll(&fd, 1, static_cast<int>(left.count()));
+			}
+		}
+
+		auto wait_focus_in(std::chrono::milliseconds timeout) -> std::optional<clock::time_point> {
+			const auto deadline = clock::now() + timeout;
+			pollfd fd{ ConnectionNumber(m_dpy), POLLIN, 0 };
+			for(;;) {
+				while(XPending(m_dpy)) {
+					XEvent e;
+					XNextEvent(m_dpy, &e);
+					if(e.type == FocusIn && e.xfocus.mode == NotifyNormal) {
+						return clock::now();
+					}
+				}
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now());
+				if(left.count() <= 0) {
+					return std::nullopt;
+				}
+				poll(&fd, 1, static_cast<int>(left.count()));
+			}
+		}
+	};
+
+	void report(const result& r) {
+		auto samples = r.samples_ms;
+		std::sort(samples.begin(), samples.end());
+		auto percentile = [&](double p) {
+			return samples.empty() ? 0.0 : samples[static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1))];
+		};
+		std::cout << std::left << std::setw(14) << r.name << std::right
+			<< std::setw(8) << samples.size()
+			<< std::setw(10) << percentile(0.5)
+			<< std::setw(10) << percentile(0.9)
+			<< std::setw(10) << percentile(0.99)
+			<< std::setw(10) << percentile(1.0);
+		if(r.wm_requests >= 0) {
+			std::cout << std::setw(12) << r.wm_requests << std::setw(12) << r.client_requests;
+		}
+		std::cout << '\n';
+	}
+
+	auto usage(const char* self) -> int {
+		std::cerr << "usage: " << self << " [--btwm PATH] [--xvfb PATH] [--clients N] [--storm N]\n";
+		return 1;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::string btwm = BTWM_BINARY;
+	std::string xvfb = BTWM_XVFB;
+	std::size_t clients = 16;
+	std::size_t storm_clients = 200;
+	for(int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if(i + 1 >= argc) { return usage(argv[0]); }
+		if(arg == "--btwm") { btwm = argv[++i]; }
+		else if(arg == "--xvfb") { xvfb = argv[++i]; }
+		else if(arg == "--clients") { clients = std::max<std::size_t>(2, std::stoul(argv[++i])); }
+		else if(arg == "--storm") { storm_clients = std::max<std::size_t>(1, std::stoul(argv[++i])); }
+		else { return usage(argv[0]); }
+	}
+
+	// pick a display number nobody uses
+	int number = 90;
+	while(access(("/tmp/.X11-unix/X" + std::to_string(number)).c_str(), F_OK) == 0) {
+		++number;
+	}
+	const auto display_name = ":" + std::to_string(number);
+	auto server = spawn({ xvfb, display_name, "-screen", "0", "1920x1080x24", "-nolisten", "tcp" }, display_name, "");
+
+	int status = 0;
+	try {
+		harness h(btwm, display_name);
+		std::cout << std::fixed << std::setprecision(2)
+			<< std::left << std::setw(14) << "scenario" << std::right
+			<< std::setw(8) << "n" << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms"
+			<< std::setw(10) << "p99 ms" << std::setw(10) << "max ms"
+			<< std::setw(12) << "wm reqs" << std::setw(12) << "client reqs" << '\n';
+		report(h.map_latency(clients));
+		report(h.focus_latency(clients, 4 * clients));
+		auto [map_storm, unmap_storm] = h.storm(storm_clients, 5);
+		report(map_storm);
+		report(unmap_storm);
+	}
+	catch(const std::exception& e) {
+		std::cerr << "btwm_stress: " << e.what() << '\n';
+		status = 1;
+	}
+	stop(server);
+	return status;
+}